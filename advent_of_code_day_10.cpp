@@ -200,6 +200,11 @@ Find the signal strength during the 20th, 60th, 100th, 140th, 180th, and 220th c
 #include<iostream>
 #include<vector>
 #include<string>
+#include<cstdlib>
+#include<algorithm>
+#include<stdint.h>
+#include<assert.h>
+#include<unistd.h>
 
 // Write a function to read in the raw program
 std::vector<std::string> readProgram(const std::string & filename)
@@ -215,108 +220,460 @@ std::vector<std::string> readProgram(const std::string & filename)
   return vectorToReturn;
 }
 
-// Write a class for the CPU. It will have one register and a "clock" to count the cycle
+// The program compiled down to what the CPU actually needs: an opcode, the register it
+// works on, how many cycles it takes and its integer operand. Running it then involves
+// no string work at all.
+enum Opcode : uint8_t
+{
+  NOOP,
+  // Add the operand to a register
+  ADD,
+  // Multiply a register by the operand
+  MUL,
+  // Do nothing for as many cycles as the operand
+  WAIT
+};
+
+// X is the register the puzzle's CPU has. It positions the sprite and sets the signal strength.
+enum Register
+{
+  REGISTER_X,
+  REGISTER_Y,
+  NUMBER_OF_REGISTERS
+};
+
+struct Instruction
+{
+  Instruction(Opcode opcode, int registerIndex, long long cycles, int immediate) : m_Opcode(opcode), m_Register(registerIndex), m_Cycles(cycles), m_Immediate(immediate) {};
+  Opcode m_Opcode;
+  uint8_t m_Register;
+  long long m_Cycles;
+  int m_Immediate;
+};
+
+// Everything the compiler needs to know about one instruction of the assembly language
+struct OpcodeInfo
+{
+  OpcodeInfo(const char * mnemonic, Opcode opcode, Register registerIndex, int cycles, bool hasOperand) : m_Mnemonic(mnemonic), m_Opcode(opcode), m_Register(registerIndex), m_Cycles(cycles), m_HasOperand(hasOperand) {};
+  const char * m_Mnemonic;
+  Opcode m_Opcode;
+  Register m_Register;
+  // Zero means the instruction takes as many cycles as its operand
+  int m_Cycles;
+  bool m_HasOperand;
+};
+
+// The instruction set. Supporting a new mnemonic only takes a line here, plus a case in
+// applyResult if it needs a new opcode.
+const OpcodeInfo OPCODE_REGISTRY[] =
+{
+  OpcodeInfo("noop", NOOP, REGISTER_X, 1, false),
+  // We know that an "addx" requires two cycles. During the first cycle, the register
+  // stays the same. During the second cycle, the register also stays the same, but at
+  // the end of the second cycle, we increment the register.
+  OpcodeInfo("addx", ADD, REGISTER_X, 2, true),
+  OpcodeInfo("addy", ADD, REGISTER_Y, 2, true),
+  OpcodeInfo("mulx", MUL, REGISTER_X, 2, true),
+  OpcodeInfo("muly", MUL, REGISTER_Y, 2, true),
+  OpcodeInfo("wait", WAIT, REGISTER_X, 0, true)
+};
+
+// What an instruction does to the registers once all of its cycles are over
+void applyResult(const Instruction & instruction, long long * registers)
+{
+  switch (instruction.m_Opcode)
+  {
+    case NOOP:
+    case WAIT:
+      break;
+    case ADD:
+      registers[instruction.m_Register] += instruction.m_Immediate;
+      break;
+    case MUL:
+      registers[instruction.m_Register] *= instruction.m_Immediate;
+      break;
+  }
+}
+
+// Lines are a mnemonic from OPCODE_REGISTRY, followed by an integer if it takes one, such
+// as "noop" or "addx some_integer". Returns false for anything else.
+bool compileInstruction(const std::string & line, Instruction & instruction)
+{
+  size_t spacePosition = line.find(" ");
+  std::string mnemonic = line.substr(0, spacePosition);
+  for (auto & info : OPCODE_REGISTRY)
+  {
+    if (mnemonic != info.m_Mnemonic)
+      continue;
+    // A missing operand counts as 0
+    int immediate = info.m_HasOperand && spacePosition != std::string::npos ? std::atoi(line.c_str() + spacePosition + 1) : 0;
+    long long cycles = info.m_Cycles > 0 ? info.m_Cycles : std::max(immediate, 0);
+    instruction = Instruction(info.m_Opcode, info.m_Register, cycles, immediate);
+    return true;
+  }
+  return false;
+}
+
+// Lines that aren't instructions are dropped, just as the CPU used to ignore them
+std::vector<Instruction> compileProgram(const std::vector<std::string> & program)
+{
+  std::vector<Instruction> bytecode;
+  bytecode.reserve(program.size());
+  Instruction instruction(NOOP, REGISTER_X, 1, 0);
+  for (auto & line : program)
+  {
+    if (compileInstruction(line, instruction))
+      bytecode.push_back(instruction);
+  }
+  return bytecode;
+}
+
+// The signal strength during one of the cycles the CPU was asked to sample
+struct SignalSample
+{
+  SignalSample(long long cycle, long long signalStrength) : m_Cycle(cycle), m_SignalStrength(signalStrength) {};
+  long long m_Cycle;
+  long long m_SignalStrength;
+};
+
+// The CRT screen, one bit per pixel with each row packed into 64-bit words. The beam
+// draws one pixel per cycle, left to right and top to bottom. Once it passes the last
+// row it either wraps back to the top, drawing over the old frame, or scrolls, so the
+// screen always shows the most recent rows.
+class Framebuffer
+{
+  public:
+    enum Overflow
+    {
+      WRAP,
+      SCROLL
+    };
+
+    Framebuffer(int width = 40, int height = 6, Overflow overflow = WRAP) : m_Width(width), m_Height(height), m_WordsPerRow((width + 63) / 64), m_Overflow(overflow), m_Pixels(height * m_WordsPerRow, 0), m_BeamRow(0), m_BeamColumn(0), m_NumberOfRowsStarted(0)
+    {
+      assert(width > 0 && height > 0);
+    }
+
+    // Draw the pixel under the beam, lit if the three-pixel sprite centred on
+    // spritePosition covers it, then move the beam on
+    void drawNextPixel(long long spritePosition)
+    {
+      if (m_BeamColumn == 0)
+        startRow();
+      int word = m_BeamColumn / 64;
+      int wordStart = word * 64;
+      // The sprite as a mask over this word's 64 columns
+      uint64_t spriteMask = 0;
+      long long spriteStart = spritePosition - 1 - wordStart;
+      if (spriteStart >= 0 && spriteStart < 64)
+        spriteMask = 7ull << spriteStart;
+      else if (spriteStart < 0 && spriteStart > -3)
+        spriteMask = 7ull >> -spriteStart;
+      uint64_t pixel = 1ull << (m_BeamColumn - wordStart);
+      uint64_t & pixels = m_Pixels[m_BeamRow * m_WordsPerRow + word];
+      pixels = (pixels & ~pixel) | (spriteMask & pixel);
+      if (++m_BeamColumn == m_Width)
+      {
+        m_BeamColumn = 0;
+        m_BeamRow = m_BeamRow + 1 == m_Height ? 0 : m_BeamRow + 1;
+      }
+    }
+
+    // row counts down from the top of the screen as it is currently shown
+    bool isLit(int row, int column) const
+    {
+      int storedRow = row;
+      // The oldest row on a scrolled screen is the one the beam will overwrite next
+      if (m_Overflow == SCROLL && m_NumberOfRowsStarted > m_Height)
+        storedRow = (m_BeamRow + (m_BeamColumn == 0 ? 0 : 1) + row) % m_Height;
+      return (m_Pixels[storedRow * m_WordsPerRow + column / 64] >> (column % 64)) & 1;
+    }
+    int getWidth() const { return m_Width;};
+    int getHeight() const { return m_Height;};
+
+    // Append the screen to text, '#' for lit pixels and '.' for dark ones, one line per row
+    void render(std::string & text) const
+    {
+      size_t start = text.size();
+      text.resize(start + (size_t)(m_Width + 1) * m_Height);
+      char * out = &text[start];
+      for (int row = 0; row < m_Height; ++row)
+      {
+        for (int column = 0; column < m_Width; ++column)
+          *out++ = isLit(row, column) ? '#' : '.';
+        *out++ = '\n';
+      }
+    }
+
+  private:
+    // When scrolling, the newest row starts out blank. When wrapping, the old frame shows
+    // through until the beam draws over it.
+    void startRow()
+    {
+      ++m_NumberOfRowsStarted;
+      if (m_Overflow == SCROLL)
+        std::fill(m_Pixels.begin() + m_BeamRow * m_WordsPerRow, m_Pixels.begin() + (m_BeamRow + 1) * m_WordsPerRow, 0);
+    }
+
+    int m_Width;
+    int m_Height;
+    int m_WordsPerRow;
+    Overflow m_Overflow;
+    std::vector<uint64_t> m_Pixels;
+    int m_BeamRow;
+    int m_BeamColumn;
+    long long m_NumberOfRowsStarted;
+};
+
+// Write all of text to a file descriptor, normally with a single write call. Returns
+// false if the write fails.
+bool writeAll(int fileDescriptor, const std::string & text)
+{
+  // Anything still buffered in std::cout has to come out first
+  std::cout.flush();
+  size_t written = 0;
+  while (written < text.size())
+  {
+    ssize_t result = write(fileDescriptor, text.data() + written, text.size() - written);
+    if (result < 0)
+      return false;
+    written += result;
+  }
+  return true;
+}
+
+// Write a class for the CPU. It will have the X and Y registers and a "clock" to count the cycle
 // It should also have the ability to consume a line of instructions.
 class CPU
 {
   public:
-    CPU() : m_Register(1), m_Cycle(0)
+    // The signal strength is only recorded during the cycles chosen up front, so memory
+    // grows with the number of samples rather than the length of the program. Either give
+    // the cycles as a list, or sample every samplePeriod cycles from firstSampleCycle up
+    // to lastSampleCycle. A default CPU samples nothing.
+    CPU() : CPU(std::vector<long long>()) {};
+    CPU(const std::vector<long long> & sampleCycles) : m_Cycle(0), m_SampleCycles(sampleCycles), m_NextSampleIndex(0), m_SamplePeriod(0), m_LastSampleCycle(0), m_FrameStream(STDOUT_FILENO), m_CyclesPerFrame(0), m_CyclesUntilFrame(-1)
+    {
+      initializeRegisters();
+      std::sort(m_SampleCycles.begin(), m_SampleCycles.end());
+      m_SampleCycles.erase(std::unique(m_SampleCycles.begin(), m_SampleCycles.end()), m_SampleCycles.end());
+      // Cycles start at 1, so earlier ones would never be reached and would hold up the rest
+      m_SampleCycles.erase(m_SampleCycles.begin(), std::lower_bound(m_SampleCycles.begin(), m_SampleCycles.end(), 1LL));
+      m_NextSampleCycle = m_SampleCycles.empty() ? NO_SAMPLE : m_SampleCycles[0];
+    }
+    CPU(long long firstSampleCycle, long long samplePeriod, long long lastSampleCycle) : m_Cycle(0), m_NextSampleCycle(firstSampleCycle), m_NextSampleIndex(0), m_SamplePeriod(samplePeriod), m_LastSampleCycle(lastSampleCycle), m_FrameStream(STDOUT_FILENO), m_CyclesPerFrame(0), m_CyclesUntilFrame(-1)
     {
-      for (int i = 0; i < 6; ++i)
-        m_CRTDisplay.push_back(std::vector<char>(40, '.'));
+      assert(samplePeriod > 0);
+      initializeRegisters();
+      // Start from the first cycle of the schedule that actually happens
+      if (firstSampleCycle < 1)
+        m_NextSampleCycle += (1 - firstSampleCycle + samplePeriod - 1) / samplePeriod * samplePeriod;
+      if (m_NextSampleCycle > lastSampleCycle)
+        m_NextSampleCycle = NO_SAMPLE;
     }
 
-    // Every time we increment the clock, calculate the signal strength
-    // and push it to the end of the vector
+    // Every time we increment the clock, calculate the signal strength if this is one
+    // of the sampled cycles
     void incrementClockAndCalculateSignalStrength()
     {
       m_Cycle += 1;
-      m_SignalStrength.push_back(m_Cycle * m_Register);
-      // Get (i, j) position on CRT monitor
-      int i = (m_Cycle - 1) / 40;
-      int j = (m_Cycle - 1) % 40;
-      // Get the register value
-      int V = getRegisterValue();
-
+      if (m_Cycle == m_NextSampleCycle)
+        recordSample();
       // The register denotes the middle position of a three-pixel sprite.
-      if ( j == V || j == V - 1 || j == V + 1)
-        m_CRTDisplay[i][j] = '#';
+      m_CRTDisplay.drawNextPixel(getRegisterValue());
+      if (--m_CyclesUntilFrame == 0)
+        streamFrame();
     }
 
-    void applyInstruction(const std::string & instruction)
+    // The registers keep their values for all of an instruction's cycles and only change
+    // at the end of the last one
+    void execute(const Instruction & instruction)
     {
-      // Instructions can be "noop" or "addx some_integer"
-      // Call the appropriate function
-      if (instruction.substr(0, 4) == "noop")
-      {
+      for (long long cycle = 0; cycle < instruction.m_Cycles; ++cycle)
         incrementClockAndCalculateSignalStrength();
-      }       
-      else if (instruction.substr(0, 4) == "addx")
+      applyResult(instruction, m_Registers);
+    }
+
+    void run(const std::vector<Instruction> & bytecode)
+    {
+      for (auto & instruction : bytecode)
+        execute(instruction);
+    }
+
+    // Compiles the line on every call, so prefer compileProgram and run for whole programs
+    void applyInstruction(const std::string & line)
+    {
+      Instruction instruction(NOOP, REGISTER_X, 1, 0);
+      if (compileInstruction(line, instruction))
+        execute(instruction);
+    }
+
+    // The whole screen goes out in one write
+    void printCRT()
+    {
+      std::string frame;
+      m_CRTDisplay.render(frame);
+      writeAll(STDOUT_FILENO, frame);
+    }
+
+    // Write the screen to fileDescriptor every cyclesPerFrame cycles, followed by a blank
+    // line, to capture an animation of the beam. Zero turns it off again.
+    void setFrameStream(int fileDescriptor, long long cyclesPerFrame)
+    {
+      m_FrameStream = fileDescriptor;
+      m_CyclesPerFrame = cyclesPerFrame;
+      m_CyclesUntilFrame = cyclesPerFrame > 0 ? cyclesPerFrame : -1;
+    }
+
+    // Swap in a screen of a different size or overflow behaviour. The default is the
+    // puzzle's 40x6 screen, wrapping back to the top.
+    void setCRTDisplay(const Framebuffer & display) { m_CRTDisplay = display; }
+    const Framebuffer & getCRTDisplay() const { return m_CRTDisplay; }
+
+    // The samples taken so far, in cycle order, as well as other get methods.
+    const std::vector<SignalSample> & getSamples() const { return m_Samples; }
+    long long getSumOfSignalStrengths() const
+    {
+      long long sum = 0;
+      for (auto & sample : m_Samples)
+        sum += sample.m_SignalStrength;
+      return sum;
+    }
+    long long getRegisterValue() { return m_Registers[REGISTER_X]; }
+    long long getRegisterValue(Register registerIndex) { return m_Registers[registerIndex]; }
+    long long getCycleNumber() { return m_Cycle; }
+  private:
+    // Cycles start at 1, so this never matches one
+    static const long long NO_SAMPLE = 0;
+
+    // X starts at 1, as in the puzzle, and the others at 0
+    void initializeRegisters()
+    {
+      std::fill(m_Registers, m_Registers + NUMBER_OF_REGISTERS, 0);
+      m_Registers[REGISTER_X] = 1;
+    }
+
+    void streamFrame()
+    {
+      m_CyclesUntilFrame = m_CyclesPerFrame;
+      // The buffer is kept between frames so streaming doesn't allocate
+      m_Frame.clear();
+      m_CRTDisplay.render(m_Frame);
+      m_Frame += '\n';
+      writeAll(m_FrameStream, m_Frame);
+    }
+
+
+    // Store the signal strength for this cycle and work out the next cycle to sample
+    void recordSample()
+    {
+      m_Samples.push_back(SignalSample(m_Cycle, m_Cycle * m_Registers[REGISTER_X]));
+      if (m_SamplePeriod > 0)
       {
-        size_t spacePosition = instruction.find(" ");
-        // Use the problem terminology and call the value by which we increment
-        // the register V.
-        int V = std::atoi(instruction.substr(spacePosition + 1).c_str());
-
-        // We know that an "addx" requires two cycles. During the first cycle, the
-        // register stays the same. During the second cycle, the register also stays
-        // the same, but at the end of the second cycle, we increment the register.
-        incrementClockAndCalculateSignalStrength();
-        incrementClockAndCalculateSignalStrength();
-        m_Register += V;
+        m_NextSampleCycle += m_SamplePeriod;
+        if (m_NextSampleCycle > m_LastSampleCycle)
+          m_NextSampleCycle = NO_SAMPLE;
+      }
+      else
+      {
+        ++m_NextSampleIndex;
+        m_NextSampleCycle = m_NextSampleIndex < m_SampleCycles.size() ? m_SampleCycles[m_NextSampleIndex] : NO_SAMPLE;
       }
     }
 
-    void printCRT()
+    long long m_Registers[NUMBER_OF_REGISTERS];
+    long long m_Cycle;
+    // Sampling from a list of cycles
+    std::vector<long long> m_SampleCycles;
+    long long m_NextSampleCycle;
+    size_t m_NextSampleIndex;
+    // Periodic sampling, when m_SamplePeriod is positive
+    long long m_SamplePeriod;
+    long long m_LastSampleCycle;
+    std::vector<SignalSample> m_Samples;
+
+    Framebuffer m_CRTDisplay;
+    // Frame streaming. m_CyclesUntilFrame counts down to the next frame, and is negative
+    // when streaming is off, so it never reaches zero.
+    int m_FrameStream;
+    long long m_CyclesPerFrame;
+    long long m_CyclesUntilFrame;
+    std::string m_Frame;
+};
+
+// Answers register queries for a compiled program without running it. X only changes
+// at the end of an instruction that writes to it, so the index keeps the cycle each of
+// those finishes on and the value of X after it. For the puzzle's addx this is a running
+// sum of the addx values. X during any cycle is then a binary search away.
+class ProgramIndex
+{
+  public:
+    ProgramIndex(const std::vector<Instruction> & bytecode) : m_NumberOfCycles(0)
     {
-      for (int i = 0; i < 6; ++i)
+      long long registers[NUMBER_OF_REGISTERS] = {0};
+      registers[REGISTER_X] = 1;
+      for (auto & instruction : bytecode)
       {
-        for (int j = 0; j < 40; ++j)
-          std::cout << m_CRTDisplay[i][j];
-        std::cout << std::endl;
+        m_NumberOfCycles += instruction.m_Cycles;
+        long long previousValue = registers[REGISTER_X];
+        applyResult(instruction, registers);
+        if (registers[REGISTER_X] != previousValue)
+        {
+          m_ChangeCycles.push_back(m_NumberOfCycles);
+          m_RegisterAfterChange.push_back(registers[REGISTER_X]);
+        }
       }
     }
 
-    // Write a method to return the vector containing all the signal strengths as well
-    // as other get methods.
-    std::vector<int> getSignalStrength() { return m_SignalStrength; }
-    int getRegisterValue() { return m_Register; }
-    int getCycleNumber() { return m_Cycle; }
+    // The value of X during cycle (1-based). Past the end of the program this is the final value.
+    long long getRegisterDuringCycle(long long cycle) const
+    {
+      // The number of changes to X that happened before this cycle started
+      size_t numberOfChanges = std::lower_bound(m_ChangeCycles.begin(), m_ChangeCycles.end(), cycle) - m_ChangeCycles.begin();
+      return numberOfChanges == 0 ? 1 : m_RegisterAfterChange[numberOfChanges - 1];
+    }
+    long long getSignalStrength(long long cycle) const { return cycle * getRegisterDuringCycle(cycle);};
+    long long getSumOfSignalStrengths(const std::vector<long long> & cycles) const
+    {
+      long long sum = 0;
+      for (auto & cycle : cycles)
+        sum += getSignalStrength(cycle);
+      return sum;
+    }
+    long long getNumberOfCycles() const { return m_NumberOfCycles;};
   private:
-    int m_Register;
-    int m_Cycle;
-    // The zeroth element of the signal strength is the value after the first cycle.
-    std::vector<int> m_SignalStrength;
-
-    // Store the CRT display as a matrix. 
-    std::vector<std::vector<char>> m_CRTDisplay;
+    long long m_NumberOfCycles;
+    // Cycle at the end of which each instruction that writes X changes it, in increasing order
+    std::vector<long long> m_ChangeCycles;
+    std::vector<long long> m_RegisterAfterChange;
 };
 
-int main()
+// Usage: advent_of_code_day_10 [--frames <cycles per frame>]
+int main(int argc, char ** argv)
 {
   // For debugging purposes, you can set the input to ./data/advent_of_code_day_10_(small)_(sample)_input.txt
   std::vector<std::string> program = readProgram("data/advent_of_code_day_10_input.txt");
-  // Instantiate the CPU object
-  CPU cpu = CPU();
+  // Instantiate the CPU object, sampling the signal strength during cycles 20, 60, ..., 220
+  CPU cpu = CPU(20, 40, 220);
+  // Optionally show the screen being drawn, one frame every so many cycles
+  if (argc > 2 && std::string(argv[1]) == "--frames")
+    cpu.setFrameStream(STDOUT_FILENO, std::atoll(argv[2]));
 
-  // Apply all the instructions to the CPU
-  for (std::vector<std::string>::iterator it = program.begin(); it != program.end(); ++it)
-    cpu.applyInstruction(*it);
+  // Compile the program once, then run all the instructions on the CPU
+  std::vector<Instruction> bytecode = compileProgram(program);
+  cpu.run(bytecode);
 
-  // Get all the signal strengths at every cycle
-  std::vector<int> signalStrength = cpu.getSignalStrength();
+  for (auto & sample : cpu.getSamples())
+    std::cout << "Signal strength at cycle " << sample.m_Cycle << " is " << sample.m_SignalStrength << std::endl;
+  std::cout << "The sum of the signal strengths after cycles 20, 60, 100, etc. is " << cpu.getSumOfSignalStrengths() << std::endl;
 
-  // Sum up the signal strengths at cycles 20, 60, etc.
-  int sumOfSignalStrengths = 0;
-  for (int i = 0; i < signalStrength.size(); ++i)
-  {
-    if (((i + 1 - 20)% 40 == 0) && i + 1 <= 220)
-    {
-      std::cout << "Signal strength at cycle " << i + 1 << " is " << signalStrength[i] << std::endl;
-      sumOfSignalStrengths += signalStrength[i];
-    }
-  }
-  std::cout << "The sum of the signal strengths after cycles 20, 60, 100, etc. is " << sumOfSignalStrengths << std::endl;
+  // The index answers the same question without stepping through the cycles
+  ProgramIndex index(bytecode);
+  std::vector<long long> sampleCycles;
+  for (auto & sample : cpu.getSamples())
+    sampleCycles.push_back(sample.m_Cycle);
+  assert(index.getSumOfSignalStrengths(sampleCycles) == cpu.getSumOfSignalStrengths());
+  assert(index.getNumberOfCycles() == cpu.getCycleNumber());
 
   // Part 2
   cpu.printCRT();
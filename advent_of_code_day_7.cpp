@@ -101,189 +101,315 @@ Find the smallest directory that, if deleted, would free up enough space on the
 #include<iostream>
 #include<fstream>
 #include<vector>
-#include<map>
+#include<algorithm>
+#include<unordered_map>
+#include<utility>
+#include<future>
+#include<thread>
+#include<atomic>
 #include<assert.h>
-#include<queue>
+#include<string.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+// Index used to mean "no folder" or "no file" in the arena
+const int NO_NODE = -1;
+
+// A view of characters that live in someone else's buffer. std::string_view would do
+// the job but needs C++17, and this file builds as C++11.
+struct StringSlice
+{
+    StringSlice() : m_Data(nullptr), m_Length(0) {};
+    StringSlice(const char* data, size_t length) : m_Data(data), m_Length(length) {};
+    StringSlice(const std::string& str) : m_Data(str.data()), m_Length(str.size()) {};
 
+    bool startsWith(const char* prefix) const
+    {
+        size_t prefixLength = strlen(prefix);
+        return m_Length >= prefixLength && memcmp(m_Data, prefix, prefixLength) == 0;
+    }
 
-class FolderNode
+    StringSlice substr(size_t position) const
+    {
+        if (position >= m_Length)
+            return StringSlice(m_Data + m_Length, 0);
+        return StringSlice(m_Data + position, m_Length - position);
+    }
+
+    bool operator==(const StringSlice& other) const
+    {
+        return m_Length == other.m_Length && (m_Length == 0 || memcmp(m_Data, other.m_Data, m_Length) == 0);
+    }
+
+    const char* m_Data;
+    size_t m_Length;
+};
+
+// Every distinct folder or file name is stored once, back to back in one character
+// buffer, and referred to everywhere else by its id
+class StringPool
 {
 public:
-    FolderNode(const std::string& folderName) : m_FolderName(folderName), m_FilesAndSizes{}, m_Children{}, m_Parent{}, m_IsDirectorySizeCalculated{false}, m_DirectorySize{0} {};
-    void setChildren(std::vector<FolderNode *> children){m_Children = children;}
-    std::vector<FolderNode *> getChildren(){ return m_Children; }
-    // void setFilesAndSizes(std::map<std::string, int> filesAndSizes){ m_FilesAndSizes = filesAndSizes; }
-    // std::map<std::string, int> getFilesAndSizes(){ return m_FilesAndSizes; }
-    void setParent(FolderNode * parentNode){ m_Parent = parentNode; }
-    FolderNode* getParent(){ return m_Parent; }
-    std::string getFolderName(){ return m_FolderName; }
-
-    void addChild(FolderNode * child){ m_Children.push_back(child); }
+    StringPool() : m_Characters{}, m_Offsets(1, 0), m_Slots(16, NO_NODE) {};
 
-    void addFileNameAndFileSize(std::string filename, int filesize)
+    // Return the id of name, adding it to the pool if it isn't there yet
+    int intern(const StringSlice& name)
     {
-        // Check if we already have an entry in the map for the file name
-        std::map<std::string, int>::iterator it = m_FilesAndSizes.find(filename);
+        size_t slot = findSlot(name);
+        if (m_Slots[slot] != NO_NODE)
+            return m_Slots[slot];
+
+        int id = m_Offsets.size() - 1;
+        m_Characters.insert(m_Characters.end(), name.m_Data, name.m_Data + name.m_Length);
+        m_Offsets.push_back(m_Characters.size());
+        m_Slots[slot] = id;
+
+        // Keep the table at most half full so probe sequences stay short
+        if (2 * m_Offsets.size() > m_Slots.size())
+            grow();
+        return id;
+    }
 
-        if (it != m_FilesAndSizes.end())
+    // Return the id of name, or NO_NODE if it has never been interned
+    int find(const StringSlice& name) const { return m_Slots[findSlot(name)]; }
+
+    // Only valid until the next call to intern
+    StringSlice getName(int id) const { return StringSlice(m_Characters.data() + m_Offsets[id], m_Offsets[id + 1] - m_Offsets[id]); }
+
+private:
+    static size_t hashName(const StringSlice& name)
+    {
+        // FNV-1a
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < name.m_Length; ++i)
         {
-            // So if we already have an entry for this file, we want to check that the 
-            // file size is the same and do nothing
-            assert(it->second == filesize);
+            hash ^= (unsigned char)name.m_Data[i];
+            hash *= 1099511628211ULL;
         }
-        else
-            m_FilesAndSizes.emplace(filename, filesize);
+        return hash;
     }
 
-    int calculateDirectorySize()
+    // Linear probing: the slot holding name, or the empty slot where it would go
+    size_t findSlot(const StringSlice& name) const
     {
-        int totalSum = 0;
-        // In the current directory, sum up the size of the files
-        for (std::map<std::string, int>::iterator it = m_FilesAndSizes.begin(); it != m_FilesAndSizes.end(); ++it)
-            totalSum += it->second;
-
-        // Now we have to get the size of all the children directories
-        for (std::vector<FolderNode* >::iterator jt = m_Children.begin(); jt != m_Children.end(); ++jt)
-            totalSum += (*jt)->calculateDirectorySize();
-        
-        return totalSum;
+        size_t mask = m_Slots.size() - 1;
+        size_t slot = hashName(name) & mask;
+        while (m_Slots[slot] != NO_NODE && !(getName(m_Slots[slot]) == name))
+            slot = (slot + 1) & mask;
+        return slot;
     }
 
-    int getDirectorySize()
+    void grow()
     {
-        if (!m_IsDirectorySizeCalculated)
+        std::vector<int> oldSlots(2 * m_Slots.size(), NO_NODE);
+        oldSlots.swap(m_Slots);
+        size_t mask = m_Slots.size() - 1;
+        for (size_t i = 0; i < oldSlots.size(); ++i)
         {
-            m_DirectorySize = calculateDirectorySize();
-            m_IsDirectorySizeCalculated = true;
+            if (oldSlots[i] == NO_NODE)
+                continue;
+            size_t slot = hashName(getName(oldSlots[i])) & mask;
+            while (m_Slots[slot] != NO_NODE)
+                slot = (slot + 1) & mask;
+            m_Slots[slot] = oldSlots[i];
         }
-        return m_DirectorySize;
     }
 
-private:
-    std::string m_FolderName;
-    std::map<std::string, int> m_FilesAndSizes;
-    std::vector<FolderNode*> m_Children;
-    FolderNode* m_Parent;
-    bool m_IsDirectorySizeCalculated;
-    int m_DirectorySize;
+    std::vector<char> m_Characters;
+    // Name i is m_Characters[m_Offsets[i], m_Offsets[i + 1])
+    std::vector<size_t> m_Offsets;
+    // Open-addressing hash table of name ids
+    std::vector<int> m_Slots;
 };
 
-std::vector<std::string> readInTerminalOutput(std::string fileName)
+// A folder only stores indices into the arrays owned by FileSystem. Children are kept
+// as a first-child/next-sibling list and files as a singly linked list through the
+// file columns, so adding a folder or a file never allocates per node.
+struct FolderNode
 {
-    std::ifstream file (fileName);
-    std::string line;
-    std::vector<std::string> vectorToReturn;
-    if (file.is_open())
-    {
-        while(std::getline(file, line))
-            vectorToReturn.push_back(line);
-        file.close();
-    }
-    return vectorToReturn;
-}
+    FolderNode(int nameId, int parent) : m_NameId(nameId), m_Parent(parent), m_FirstChild(NO_NODE), m_NextSibling(NO_NODE), m_FirstFile(NO_NODE) {};
+    int m_NameId;
+    int m_Parent;
+    int m_FirstChild;
+    int m_NextSibling;
+    int m_FirstFile;
+};
 
-bool existsDirectory(FolderNode * cursor, std::string folderName)
+// Children and files are looked up by (folder index, name id) packed into one key
+inline unsigned long long makeEntryKey(int folder, int nameId)
 {
-    // The purpose of this function is to determine if a folder with name folderName
-    // exists within the children of cursor.
-    std::vector<FolderNode *> children = cursor->getChildren();
-    std::vector<FolderNode *>::iterator it = std::find_if(children.begin(),
-                                                          children.end(),
-                                                          [folderName](FolderNode * folderNode)
-                                                          {
-                                                              if (folderNode->getFolderName() == folderName)
-                                                                  return true;
-                                                              else
-                                                                  return false;
-                                                          });
-    return it == children.end() ? false : true;
+    return ((unsigned long long)(unsigned int)folder << 32) | (unsigned int)nameId;
 }
 
-FolderNode * findFolderWithinChildren(FolderNode * cursor, std::string folderName)
+class FileSystem
 {
-    std::vector<FolderNode *> children = cursor->getChildren();
-    std::vector<FolderNode *>::iterator it = std::find_if(children.begin(),
-                                                          children.end(),
-                                                          [folderName](FolderNode * node)
-                                                          {
-                                                               if (node->getFolderName() == folderName)
-                                                                   return true;
-                                                               else
-                                                                   return false;
-                                                          });
-    assert(it != children.end());
-    return (*it);
-
-                    
-}
+public:
+    // With trackSizesWhileParsing off, adding a file only touches its own folder and the
+    // totals are left to aggregateDirectorySizes once the log has been read
+    FileSystem(bool trackSizesWhileParsing = true) : m_Folders{}, m_Names{}, m_FileNameIds{}, m_FileSizes{}, m_NextFile{}, m_ChildIndex{}, m_FileIndex{},
+        m_TrackSizesWhileParsing(trackSizesWhileParsing), m_DirectorySizes{}, m_OwnSizes{}, m_UsedSpace(0) {};
+
+    // Add a folder under parent (NO_NODE for the root) and return its index
+    int addFolder(const StringSlice& folderName, int parent)
+    {
+        int index = m_Folders.size();
+        int nameId = m_Names.intern(folderName);
+        m_Folders.push_back(FolderNode(nameId, parent));
+        m_DirectorySizes.push_back(0);
+        m_OwnSizes.push_back(0);
+        if (parent != NO_NODE)
+        {
+            // Prepend to the parent's list of children
+            m_Folders[index].m_NextSibling = m_Folders[parent].m_FirstChild;
+            m_Folders[parent].m_FirstChild = index;
+            m_ChildIndex.emplace(makeEntryKey(parent, nameId), index);
+        }
+        return index;
+    }
+
+    void addFileNameAndFileSize(int folder, const StringSlice& filename, long long filesize)
+    {
+        // Check if we already have an entry in this folder for the file name
+        int file = m_FileSizes.size();
+        int nameId = m_Names.intern(filename);
+        std::pair<std::unordered_map<unsigned long long, int>::iterator, bool> inserted =
+            m_FileIndex.emplace(makeEntryKey(folder, nameId), file);
+        if (!inserted.second)
+        {
+            // So if we already have an entry for this file, we want to check that the
+            // file size is the same and do nothing
+            assert(m_FileSizes[inserted.first->second] == filesize);
+            return;
+        }
+        m_FileNameIds.push_back(nameId);
+        m_FileSizes.push_back(filesize);
+        m_NextFile.push_back(m_Folders[folder].m_FirstFile);
+        m_Folders[folder].m_FirstFile = file;
+
+        m_OwnSizes[folder] += filesize;
+        m_UsedSpace += filesize;
+
+        // Add the file to the folder and every folder above it, so sizes are always
+        // up to date no matter how much of the log has been read
+        if (m_TrackSizesWhileParsing)
+        {
+            for (int ancestor = folder; ancestor != NO_NODE; ancestor = m_Folders[ancestor].m_Parent)
+                m_DirectorySizes[ancestor] += filesize;
+        }
+    }
 
-FolderNode * parseTerminalOutput(const std::vector<std::string>& terminalOutput)
+    // Return the index of the child of folder called folderName, or NO_NODE
+    int findChild(int folder, const StringSlice& folderName) const
+    {
+        // A name that was never interned can't belong to any folder
+        int nameId = m_Names.find(folderName);
+        if (nameId == NO_NODE)
+            return NO_NODE;
+        std::unordered_map<unsigned long long, int>::const_iterator it = m_ChildIndex.find(makeEntryKey(folder, nameId));
+        return it == m_ChildIndex.end() ? NO_NODE : it->second;
+    }
+
+    int getNumberOfFolders() const { return m_Folders.size(); }
+    int getParent(int folder) const { return m_Folders[folder].m_Parent; }
+    int getFirstChild(int folder) const { return m_Folders[folder].m_FirstChild; }
+    int getNextSibling(int folder) const { return m_Folders[folder].m_NextSibling; }
+    StringSlice getFolderName(int folder) const { return m_Names.getName(m_Folders[folder].m_NameId); }
+
+    long long getDirectorySize(int folder) const { return m_DirectorySizes[folder]; }
+    void setDirectorySize(int folder, long long size) { m_DirectorySizes[folder] = size; }
+    // Size of the files directly inside folder, not counting subfolders
+    long long getOwnSize(int folder) const { return m_OwnSizes[folder]; }
+    // Size of every file in the file system
+    long long getUsedSpace() const { return m_UsedSpace; }
+
+private:
+    std::vector<FolderNode> m_Folders;
+    StringPool m_Names;
+    // File columns: entry i of each vector describes file i
+    std::vector<int> m_FileNameIds;
+    std::vector<long long> m_FileSizes;
+    std::vector<int> m_NextFile;
+    // Hash indices from (folder, name id) to the child folder or file
+    std::unordered_map<unsigned long long, int> m_ChildIndex;
+    std::unordered_map<unsigned long long, int> m_FileIndex;
+    bool m_TrackSizesWhileParsing;
+    // Folder columns: the total size of each folder given the lines read so far and the
+    // size of its own files
+    std::vector<long long> m_DirectorySizes;
+    std::vector<long long> m_OwnSizes;
+    long long m_UsedSpace;
+};
+
+// Builds a FileSystem from terminal output one line at a time, so a log can be fed
+// in as it grows. The root folder is always at index 0.
+class TerminalOutputParser
 {
-    // Define a pointer to the root node
-    FolderNode * rootNode = nullptr;
+public:
+    TerminalOutputParser(bool trackSizesWhileParsing = true) : m_FileSystem(trackSizesWhileParsing), m_Cursor(NO_NODE) {};
 
-    // Define a pointer to a cursor
-    FolderNode * cursor;
+    const FileSystem& getFileSystem() const { return m_FileSystem; }
+    FileSystem& getFileSystem() { return m_FileSystem; }
 
-    for (auto & line : terminalOutput)
+    // line only needs to stay alive for the duration of the call
+    void parseLine(const StringSlice& line)
     {
         // We need to identify our inputs, which begin with "$"
         // $ cd /
         // $ cd fml
         // $ cd ..
         // $ ls
-        if (line.substr(0, 1) == "$")
+        if (line.startsWith("$"))
         {
-            if (line.substr(2, 2) == "cd")
+            if (line.substr(2).startsWith("cd"))
             {
                 // Two possibilities: choose a folder or go up a level
-                if (line.substr(5) == "..")
+                if (line.substr(5) == StringSlice("..", 2))
                 {
-                    cursor = cursor->getParent();
-                    continue;
+                    m_Cursor = m_FileSystem.getParent(m_Cursor);
+                    return;
                 }
                 // Here we are choosing a folder
                 else
                 {
-                    std::string directoryName = line.substr(5);
+                    StringSlice directoryName = line.substr(5);
 
-                    // If this is the first line, then create a new folder node
-                    if (!rootNode)
+                    // If this is the first line, then create the root folder
+                    if (m_Cursor == NO_NODE)
                     {
-                        rootNode = new FolderNode(directoryName);
-                        cursor = &(*rootNode);
-                        continue;
+                        m_Cursor = m_FileSystem.addFolder(directoryName, NO_NODE);
+                        return;
                     }
 
-                    // Find directory name within the children
-                    bool doesDirectoryExist = existsDirectory(cursor, directoryName);
-                    if (!doesDirectoryExist)
+                    // cd / jumps straight back to the root
+                    if (directoryName == m_FileSystem.getFolderName(0))
                     {
-                        FolderNode * newFolder = new FolderNode(directoryName);
-                        
-                        // Set the parent node of the new folder to the cursor.
-                        newFolder->setParent(cursor);
-
-                        // Then add the new folder as a child of the cursor.
-                        cursor->addChild(newFolder);
+                        m_Cursor = 0;
+                        return;
+                    }
 
-                        // Then go into the directory
-                        cursor = findFolderWithinChildren(cursor, directoryName);
+                    // Find directory name within the children
+                    int child = m_FileSystem.findChild(m_Cursor, directoryName);
+                    if (child == NO_NODE)
+                    {
+                        // Add the new folder as a child of the cursor, then go into it
+                        m_Cursor = m_FileSystem.addFolder(directoryName, m_Cursor);
                     }
                     else
                     {
                         // If the folder was found, then let's move the cursor to it
-                        cursor = findFolderWithinChildren(cursor, directoryName); 
+                        m_Cursor = child;
                     }
-                    continue;
+                    return;
                 }
 
             }
-            else if (line.substr(2, 2) == "ls")
+            else if (line.substr(2).startsWith("ls"))
             {
                 // ls technically doesn't do anything. It's just a place holder to tell us that we're gonna list
                 // off a bunch of stuff
-                continue;
+                return;
             }
         }
         // The other lines are just the result from ls
@@ -297,100 +423,597 @@ FolderNode * parseTerminalOutput(const std::vector<std::string>& terminalOutput)
             //
             // This means that it is written as ["dir", folder_name] or [number, file_name]
             // Check if the first three characters are
-            if (line.substr(0, 3) == "dir")
+            if (line.startsWith("dir"))
             {
-                std::string directoryName = line.substr(4);
+                StringSlice directoryName = line.substr(4);
                 // If this directory exists within the children nothing to do
-                if (existsDirectory(cursor, directoryName))
-                    continue;
-                else
-                {
-                    FolderNode * childNode = new FolderNode(directoryName);
-                    childNode->setParent(cursor);
-                    cursor->addChild(childNode);
-                    continue;
-                }
+                if (m_FileSystem.findChild(m_Cursor, directoryName) == NO_NODE)
+                    m_FileSystem.addFolder(directoryName, m_Cursor);
             }
             else
             {
                 // Now we are dealing with files.
                 // Find the space that splits the file size from the file name
 
-                size_t spacePosition = line.find(" ");
-                assert(spacePosition != std::string::npos);
-                int fileSize = std::atoi(line.substr(0, spacePosition).c_str());
-                std::string fileName = line.substr(spacePosition + 1);
-                cursor->addFileNameAndFileSize(fileName, fileSize);
+                size_t spacePosition = 0;
+                long long fileSize = 0;
+                while (spacePosition < line.m_Length && line.m_Data[spacePosition] != ' ')
+                    fileSize = 10 * fileSize + (line.m_Data[spacePosition++] - '0');
+                assert(spacePosition < line.m_Length);
+                m_FileSystem.addFileNameAndFileSize(m_Cursor, line.substr(spacePosition + 1), fileSize);
             }
-            continue;
         }
     }
-    return rootNode;
+
+private:
+    FileSystem m_FileSystem;
+    // Index of the folder we are currently in
+    int m_Cursor;
+};
+
+// Feed the terminal output in fileName through the parser one line at a time. The file
+// is read in large blocks into one buffer that is reused for the whole file, and each
+// line is handed over as a slice of it, so no per-line strings are made. Returns false
+// if the file can't be opened or read.
+bool readInTerminalOutput(const std::string& fileName, TerminalOutputParser& parser)
+{
+    std::ifstream file (fileName, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::vector<char> buffer(1 << 20);
+    size_t filled = 0;
+    while (file)
+    {
+        // A single line longer than the buffer: make room for it
+        if (filled == buffer.size())
+            buffer.resize(2 * buffer.size());
+        file.read(buffer.data() + filled, buffer.size() - filled);
+        filled += file.gcount();
+
+        // Hand over every complete line
+        const char * lineStart = buffer.data();
+        const char * end = buffer.data() + filled;
+        const char * newline;
+        while ((newline = (const char *)memchr(lineStart, '\n', end - lineStart)) != nullptr)
+        {
+            parser.parseLine(StringSlice(lineStart, newline - lineStart));
+            lineStart = newline + 1;
+        }
+
+        // Keep the partial last line for the next block
+        filled = end - lineStart;
+        memmove(buffer.data(), lineStart, filled);
+    }
+
+    // The last line may not end with a newline
+    if (filled > 0)
+        parser.parseLine(StringSlice(buffer.data(), filled));
+    bool readAll = !file.bad();
+    file.close();
+    return readAll;
 }
 
-void calculateSumOfDirectoriesWithSizeLessThanThreshold(FolderNode * root, int threshold, int & total)
+// Directory sizes in ascending order plus running totals, wherever they are stored,
+// so threshold and deletion queries are binary searches instead of walks over the tree
+struct SortedSizeView
+{
+    SortedSizeView(const long long * sortedSizes, const long long * prefixSums, size_t count) : m_SortedSizes(sortedSizes), m_PrefixSums(prefixSums), m_Count(count) {};
+
+    // Sum of all directory sizes strictly below threshold
+    long long sumOfSizesLessThan(long long threshold) const
+    {
+        size_t count = std::lower_bound(m_SortedSizes, m_SortedSizes + m_Count, threshold) - m_SortedSizes;
+        return m_PrefixSums[count];
+    }
+
+    // Smallest directory size strictly above requiredSize, or -1 if there isn't one
+    long long smallestSizeGreaterThan(long long requiredSize) const
+    {
+        const long long * it = std::upper_bound(m_SortedSizes, m_SortedSizes + m_Count, requiredSize);
+        return it == m_SortedSizes + m_Count ? -1 : *it;
+    }
+
+    // The root holds everything, so it is the largest directory
+    long long getUsedSpace() const { return m_Count == 0 ? 0 : m_SortedSizes[m_Count - 1]; }
+
+    const long long * m_SortedSizes;
+    // m_PrefixSums[i] is the sum of the i smallest sizes, so it has m_Count + 1 entries
+    const long long * m_PrefixSums;
+    size_t m_Count;
+};
+
+// Sorts every directory size of a parsed FileSystem once
+class DirectorySizeIndex
 {
-    int dirSize = root->getDirectorySize();
-    if (dirSize < threshold)
-        total += dirSize;
-    std::vector<FolderNode *> children = root->getChildren();
-    for (int i = 0; i < children.size(); ++i)
-        calculateSumOfDirectoriesWithSizeLessThanThreshold(children[i], threshold, total);
+public:
+    DirectorySizeIndex(const FileSystem & fileSystem) : m_SortedSizes{}, m_PrefixSums{}
+    {
+        int numberOfFolders = fileSystem.getNumberOfFolders();
+        m_SortedSizes.reserve(numberOfFolders);
+        for (int folder = 0; folder < numberOfFolders; ++folder)
+            m_SortedSizes.push_back(fileSystem.getDirectorySize(folder));
+        std::sort(m_SortedSizes.begin(), m_SortedSizes.end());
+
+        m_PrefixSums.reserve(numberOfFolders + 1);
+        m_PrefixSums.push_back(0);
+        for (int i = 0; i < numberOfFolders; ++i)
+            m_PrefixSums.push_back(m_PrefixSums.back() + m_SortedSizes[i]);
+    }
+
+    SortedSizeView getView() const { return SortedSizeView(m_SortedSizes.data(), m_PrefixSums.data(), m_SortedSizes.size()); }
+
+private:
+    std::vector<long long> m_SortedSizes;
+    std::vector<long long> m_PrefixSums;
+};
+
+void calculateSumOfDirectoriesWithSizeLessThanThreshold(const SortedSizeView & index, long long threshold, long long & total)
+{
+    total += index.sumOfSizesLessThan(threshold);
 }
 
 // Part 2
-int calculateSizeOfSmallestDirectoryToDelete(int totalFileSystemSize, int spaceRequiredForUpdate, FolderNode * root)
+long long calculateSizeOfSmallestDirectoryToDelete(long long totalFileSystemSize, long long spaceRequiredForUpdate, const SortedSizeView & index)
 {
     // Get current amount of used space
-    int usedSpace = root->getDirectorySize();
+    long long usedSpace = index.getUsedSpace();
 
     // Get free space
-    int freeSpace = totalFileSystemSize - usedSpace;
+    long long freeSpace = totalFileSystemSize - usedSpace;
 
     // Get the additional amount of space needed
-    int additionalRequiredSpace = spaceRequiredForUpdate - freeSpace;
-
-    // Make a vector to hold the sizes of all directories whose space exceeds additionalRequiredSpace.
-    std::vector<int> candidates;
-
-    std::queue<FolderNode *> queue;
-    queue.push(root);
-    FolderNode * cur;
-    int dirSize;
-
-    while(!queue.empty())
-    {
-        cur = queue.front();
-        queue.pop();
-        dirSize = cur->getDirectorySize();
-        if (dirSize > additionalRequiredSpace)
-            candidates.push_back(dirSize);
-        
-        std::vector<FolderNode *> children = cur->getChildren();
-        for (int i = 0; i < children.size(); ++i)
+    long long additionalRequiredSpace = spaceRequiredForUpdate - freeSpace;
+
+    // The first directory whose size exceeds additionalRequiredSpace is the one to delete
+    return index.smallestSizeGreaterThan(additionalRequiredSpace);
+}
+
+// The same two queries straight off a FileSystem that is still being parsed. These
+// scan the size column once instead of needing an index to be built.
+void calculateSumOfDirectoriesWithSizeLessThanThreshold(const FileSystem & fileSystem, long long threshold, long long & total)
+{
+    for (int folder = 0; folder < fileSystem.getNumberOfFolders(); ++folder)
+    {
+        long long dirSize = fileSystem.getDirectorySize(folder);
+        if (dirSize < threshold)
+            total += dirSize;
+    }
+}
+
+long long calculateSizeOfSmallestDirectoryToDelete(long long totalFileSystemSize, long long spaceRequiredForUpdate, const FileSystem & fileSystem)
+{
+    if (fileSystem.getNumberOfFolders() == 0)
+        return -1;
+    long long additionalRequiredSpace = spaceRequiredForUpdate - (totalFileSystemSize - fileSystem.getDirectorySize(0));
+    long long smallest = -1;
+    for (int folder = 0; folder < fileSystem.getNumberOfFolders(); ++folder)
+    {
+        long long dirSize = fileSystem.getDirectorySize(folder);
+        if (dirSize > additionalRequiredSpace && (smallest == -1 || dirSize < smallest))
+            smallest = dirSize;
+    }
+    return smallest;
+}
+
+// What aggregateDirectorySizes reduces over a subtree alongside the sizes themselves
+struct DirectorySizeSummary
+{
+    DirectorySizeSummary() : m_Size(0), m_SumBelowThreshold(0), m_SmallestAboveRequired(-1) {};
+    // Size of the subtree's root
+    long long m_Size;
+    // Sum of the directory sizes < threshold
+    long long m_SumBelowThreshold;
+    // Smallest directory size > the additional space required, or -1
+    long long m_SmallestAboveRequired;
+
+    void merge(const DirectorySizeSummary & other)
+    {
+        m_SumBelowThreshold += other.m_SumBelowThreshold;
+        if (other.m_SmallestAboveRequired != -1 && (m_SmallestAboveRequired == -1 || other.m_SmallestAboveRequired < m_SmallestAboveRequired))
+            m_SmallestAboveRequired = other.m_SmallestAboveRequired;
+    }
+
+    void addDirectory(long long dirSize, long long threshold, long long additionalRequiredSpace)
+    {
+        if (dirSize < threshold)
+            m_SumBelowThreshold += dirSize;
+        if (dirSize > additionalRequiredSpace && (m_SmallestAboveRequired == -1 || dirSize < m_SmallestAboveRequired))
+            m_SmallestAboveRequired = dirSize;
+    }
+};
+
+DirectorySizeSummary aggregateSubtreeSerially(FileSystem & fileSystem, int root, long long threshold, long long additionalRequiredSpace)
+{
+    // Collect the subtree in pre-order with an explicit stack. Walking that order
+    // backwards visits every folder after all of its descendants.
+    std::vector<int> order;
+    std::vector<int> stack(1, root);
+    while (!stack.empty())
+    {
+        int cur = stack.back();
+        stack.pop_back();
+        order.push_back(cur);
+        fileSystem.setDirectorySize(cur, fileSystem.getOwnSize(cur));
+        for (int child = fileSystem.getFirstChild(cur); child != NO_NODE; child = fileSystem.getNextSibling(child))
+            stack.push_back(child);
+    }
+
+    DirectorySizeSummary summary;
+    for (std::vector<int>::reverse_iterator it = order.rbegin(); it != order.rend(); ++it)
+    {
+        long long dirSize = fileSystem.getDirectorySize(*it);
+        summary.addDirectory(dirSize, threshold, additionalRequiredSpace);
+        if (*it != root)
         {
-            queue.push(children[i]);
+            int parent = fileSystem.getParent(*it);
+            fileSystem.setDirectorySize(parent, fileSystem.getDirectorySize(parent) + dirSize);
         }
     }
+    summary.m_Size = fileSystem.getDirectorySize(root);
+    return summary;
+}
 
-    return *std::min_element(candidates.begin(), candidates.end());
+// The number of folders in each folder's subtree, including itself. One pre-order walk,
+// then the counts are added up from the bottom, so deep trees stay linear.
+std::vector<int> countSubtreeFolders(const FileSystem & fileSystem)
+{
+    std::vector<int> counts(fileSystem.getNumberOfFolders(), 1);
+    std::vector<int> order;
+    order.reserve(counts.size());
+    std::vector<int> stack(1, 0);
+    while (!stack.empty())
+    {
+        int cur = stack.back();
+        stack.pop_back();
+        order.push_back(cur);
+        for (int child = fileSystem.getFirstChild(cur); child != NO_NODE; child = fileSystem.getNextSibling(child))
+            stack.push_back(child);
+    }
+    for (std::vector<int>::reverse_iterator it = order.rbegin(); it != order.rend(); ++it)
+    {
+        if (*it != 0)
+            counts[fileSystem.getParent(*it)] += counts[*it];
+    }
+    return counts;
+}
+
+// Fill in every directory size from the folders' own file sizes, and answer both
+// parts in the same pass. The used space is known before the walk starts, so the
+// deletion target can be checked as each directory is finished.
+//
+// Subtrees of at most serialCutoff folders are tasks that run serially on a fixed set
+// of worker threads. The few folders above the cutoff are finished afterwards from
+// their children's sizes.
+DirectorySizeSummary aggregateDirectorySizes(FileSystem & fileSystem, long long threshold, long long totalFileSystemSize, long long spaceRequiredForUpdate,
+                                             int serialCutoff = 1 << 14)
+{
+    DirectorySizeSummary summary;
+    if (fileSystem.getNumberOfFolders() == 0)
+        return summary;
+    long long additionalRequiredSpace = spaceRequiredForUpdate - (totalFileSystemSize - fileSystem.getUsedSpace());
+
+    // Split the tree at the cutoff
+    std::vector<int> subtreeFolderCounts = countSubtreeFolders(fileSystem);
+    std::vector<int> upperFolders;
+    std::vector<int> taskRoots;
+    std::vector<int> stack(1, 0);
+    while (!stack.empty())
+    {
+        int cur = stack.back();
+        stack.pop_back();
+        if (subtreeFolderCounts[cur] <= serialCutoff)
+        {
+            taskRoots.push_back(cur);
+            continue;
+        }
+        upperFolders.push_back(cur);
+        for (int child = fileSystem.getFirstChild(cur); child != NO_NODE; child = fileSystem.getNextSibling(child))
+            stack.push_back(child);
+    }
 
+    // Tasks only write sizes inside their own subtree, so they never touch the same folder
+    size_t numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    numberOfThreads = std::min(numberOfThreads, taskRoots.size());
+    std::atomic<size_t> nextTask(0);
+    std::vector<std::future<DirectorySizeSummary> > workers;
+    for (size_t i = 0; i < numberOfThreads; ++i)
+    {
+        workers.push_back(std::async(std::launch::async, [&]()
+                                     {
+                                         DirectorySizeSummary workerSummary;
+                                         for (size_t task = nextTask++; task < taskRoots.size(); task = nextTask++)
+                                             workerSummary.merge(aggregateSubtreeSerially(fileSystem, taskRoots[task], threshold, additionalRequiredSpace));
+                                         return workerSummary;
+                                     }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i)
+        summary.merge(workers[i].get());
 
+    // upperFolders is in pre-order, so walking it backwards finishes children first
+    for (std::vector<int>::reverse_iterator it = upperFolders.rbegin(); it != upperFolders.rend(); ++it)
+    {
+        long long dirSize = fileSystem.getOwnSize(*it);
+        for (int child = fileSystem.getFirstChild(*it); child != NO_NODE; child = fileSystem.getNextSibling(child))
+            dirSize += fileSystem.getDirectorySize(child);
+        fileSystem.setDirectorySize(*it, dirSize);
+        summary.addDirectory(dirSize, threshold, additionalRequiredSpace);
+    }
+    summary.m_Size = fileSystem.getDirectorySize(0);
+    return summary;
 }
+// On-disk layout of a parsed file system, version 2. Everything is in the host's byte
+// order, and every section starts on an 8-byte boundary so it can be used in place
+// once the file is mapped:
+//
+//   SnapshotHeader
+//   int       parents[n]          (NO_NODE for the root)
+//   int       firstChildren[n]
+//   int       nextSiblings[n]
+//   long long directorySizes[n]
+//   long long sortedSizes[n]
+//   long long prefixSums[n + 1]
+//   long long nameOffsets[n + 1]  (folder i's name is names[nameOffsets[i], nameOffsets[i + 1]))
+//   char      names[nameBytes]
+const char SNAPSHOT_MAGIC[8] = {'A', 'O', 'C', '7', 'S', 'N', 'A', 'P'};
+const unsigned int SNAPSHOT_VERSION = 2;
+
+// Identifies the version of the log a snapshot was made from. Modification times only
+// have one-second resolution on some systems, so the size is compared as well; a log
+// that grew within the same second still reads as changed.
+struct SourceStamp
+{
+    SourceStamp() : m_Size(-1), m_ModifiedSeconds(0), m_ModifiedNanoseconds(0) {};
+    bool operator==(const SourceStamp & other) const
+    {
+        return m_Size == other.m_Size && m_ModifiedSeconds == other.m_ModifiedSeconds && m_ModifiedNanoseconds == other.m_ModifiedNanoseconds;
+    }
+    long long m_Size;
+    long long m_ModifiedSeconds;
+    long long m_ModifiedNanoseconds;
+};
+
+// Returns false if fileName can't be found
+bool getSourceStamp(const std::string & fileName, SourceStamp & stamp)
+{
+    struct stat fileStatus;
+    if (stat(fileName.c_str(), &fileStatus) != 0)
+        return false;
+    stamp.m_Size = fileStatus.st_size;
+#ifdef __APPLE__
+    stamp.m_ModifiedSeconds = fileStatus.st_mtimespec.tv_sec;
+    stamp.m_ModifiedNanoseconds = fileStatus.st_mtimespec.tv_nsec;
+#else
+    stamp.m_ModifiedSeconds = fileStatus.st_mtim.tv_sec;
+    stamp.m_ModifiedNanoseconds = fileStatus.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+struct SnapshotHeader
+{
+    char m_Magic[8];
+    unsigned int m_Version;
+    unsigned int m_NumberOfFolders;
+    unsigned long long m_NameBytes;
+    long long m_UsedSpace;
+    // The log the snapshot was parsed from
+    SourceStamp m_Source;
+};
+
+struct SnapshotLayout
+{
+    SnapshotLayout(size_t numberOfFolders, size_t nameBytes)
+    {
+        size_t intSection = (numberOfFolders * sizeof(int) + 7) & ~(size_t)7;
+        m_Parents = sizeof(SnapshotHeader);
+        m_FirstChildren = m_Parents + intSection;
+        m_NextSiblings = m_FirstChildren + intSection;
+        m_DirectorySizes = m_NextSiblings + intSection;
+        m_SortedSizes = m_DirectorySizes + numberOfFolders * sizeof(long long);
+        m_PrefixSums = m_SortedSizes + numberOfFolders * sizeof(long long);
+        m_NameOffsets = m_PrefixSums + (numberOfFolders + 1) * sizeof(long long);
+        m_Names = m_NameOffsets + (numberOfFolders + 1) * sizeof(long long);
+        m_TotalBytes = m_Names + nameBytes;
+    }
+    // Byte offsets of each section from the start of the file
+    size_t m_Parents;
+    size_t m_FirstChildren;
+    size_t m_NextSiblings;
+    size_t m_DirectorySizes;
+    size_t m_SortedSizes;
+    size_t m_PrefixSums;
+    size_t m_NameOffsets;
+    size_t m_Names;
+    size_t m_TotalBytes;
+};
+
+// Write fileSystem, whose directory sizes must be complete, to fileName. source should
+// be taken before the log is read, so that anything appended while parsing makes the
+// snapshot stale. Returns false if the file couldn't be written.
+bool writeSnapshot(const FileSystem & fileSystem, const DirectorySizeIndex & index, const SourceStamp & source, const std::string & fileName)
+{
+    size_t numberOfFolders = fileSystem.getNumberOfFolders();
+    std::vector<long long> nameOffsets(1, 0);
+    for (size_t folder = 0; folder < numberOfFolders; ++folder)
+        nameOffsets.push_back(nameOffsets.back() + fileSystem.getFolderName(folder).m_Length);
+    SnapshotLayout layout(numberOfFolders, nameOffsets.back());
+
+    std::vector<char> image(layout.m_TotalBytes, 0);
+    SnapshotHeader header;
+    memcpy(header.m_Magic, SNAPSHOT_MAGIC, sizeof(header.m_Magic));
+    header.m_Version = SNAPSHOT_VERSION;
+    header.m_NumberOfFolders = numberOfFolders;
+    header.m_NameBytes = nameOffsets.back();
+    header.m_UsedSpace = fileSystem.getUsedSpace();
+    header.m_Source = source;
+    memcpy(image.data(), &header, sizeof(header));
+
+    int * parents = (int *)(image.data() + layout.m_Parents);
+    int * firstChildren = (int *)(image.data() + layout.m_FirstChildren);
+    int * nextSiblings = (int *)(image.data() + layout.m_NextSiblings);
+    long long * directorySizes = (long long *)(image.data() + layout.m_DirectorySizes);
+    char * names = image.data() + layout.m_Names;
+    for (size_t folder = 0; folder < numberOfFolders; ++folder)
+    {
+        parents[folder] = fileSystem.getParent(folder);
+        firstChildren[folder] = fileSystem.getFirstChild(folder);
+        nextSiblings[folder] = fileSystem.getNextSibling(folder);
+        directorySizes[folder] = fileSystem.getDirectorySize(folder);
+        StringSlice name = fileSystem.getFolderName(folder);
+        if (name.m_Length > 0)
+            memcpy(names + nameOffsets[folder], name.m_Data, name.m_Length);
+    }
+    SortedSizeView view = index.getView();
+    memcpy(image.data() + layout.m_SortedSizes, view.m_SortedSizes, numberOfFolders * sizeof(long long));
+    memcpy(image.data() + layout.m_PrefixSums, view.m_PrefixSums, (numberOfFolders + 1) * sizeof(long long));
+    memcpy(image.data() + layout.m_NameOffsets, nameOffsets.data(), (numberOfFolders + 1) * sizeof(long long));
+
+    std::ofstream file (fileName, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+    file.write(image.data(), image.size());
+    file.close();
+    return !file.fail();
+}
+
+// A snapshot written by writeSnapshot, mapped read-only and queried in place
+class FileSystemSnapshot
+{
+public:
+    FileSystemSnapshot() : m_Data(nullptr), m_Length(0), m_Layout(0, 0) {};
+    ~FileSystemSnapshot() { close(); }
+
+    // Returns false if the file is missing, truncated, not a version 2 snapshot or was
+    // made from a different version of the log than source
+    bool open(const std::string & fileName, const SourceStamp & source)
+    {
+        close();
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat fileStatus;
+        if (fstat(fd, &fileStatus) != 0 || (size_t)fileStatus.st_size < sizeof(SnapshotHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        void * data = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        m_Data = (const char *)data;
+        m_Length = fileStatus.st_size;
+
+        const SnapshotHeader & header = getHeader();
+        m_Layout = SnapshotLayout(header.m_NumberOfFolders, header.m_NameBytes);
+        if (memcmp(header.m_Magic, SNAPSHOT_MAGIC, sizeof(header.m_Magic)) != 0 || header.m_Version != SNAPSHOT_VERSION
+            || m_Layout.m_TotalBytes != m_Length || !(header.m_Source == source))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (m_Data)
+            munmap((void *)m_Data, m_Length);
+        m_Data = nullptr;
+        m_Length = 0;
+    }
+
+    int getNumberOfFolders() const { return getHeader().m_NumberOfFolders; }
+    long long getUsedSpace() const { return getHeader().m_UsedSpace; }
+    int getParent(int folder) const { return ((const int *)(m_Data + m_Layout.m_Parents))[folder]; }
+    int getFirstChild(int folder) const { return ((const int *)(m_Data + m_Layout.m_FirstChildren))[folder]; }
+    int getNextSibling(int folder) const { return ((const int *)(m_Data + m_Layout.m_NextSiblings))[folder]; }
+    long long getDirectorySize(int folder) const { return ((const long long *)(m_Data + m_Layout.m_DirectorySizes))[folder]; }
+    StringSlice getFolderName(int folder) const
+    {
+        const long long * nameOffsets = (const long long *)(m_Data + m_Layout.m_NameOffsets);
+        return StringSlice(m_Data + m_Layout.m_Names + nameOffsets[folder], nameOffsets[folder + 1] - nameOffsets[folder]);
+    }
+
+    SortedSizeView getSizeView() const
+    {
+        return SortedSizeView((const long long *)(m_Data + m_Layout.m_SortedSizes), (const long long *)(m_Data + m_Layout.m_PrefixSums), getNumberOfFolders());
+    }
+
+private:
+    // Not copyable: the mapping is released in the destructor
+    FileSystemSnapshot(const FileSystemSnapshot &);
+    FileSystemSnapshot & operator=(const FileSystemSnapshot &);
+
+    const SnapshotHeader & getHeader() const { return *(const SnapshotHeader *)m_Data; }
+
+    const char * m_Data;
+    size_t m_Length;
+    SnapshotLayout m_Layout;
+};
 
 
 int main()
 {
-    std::vector<std::string> terminalOutput = readInTerminalOutput("./data/advent_of_code_day_7_input.txt");
-    FolderNode * root = parseTerminalOutput(terminalOutput);
-    int total = 0;
-    int threshold = 100000;
-    // Now traverse the file tree and count the folders whose folder sizes are < 10k
-    calculateSumOfDirectoriesWithSizeLessThanThreshold(root, threshold, total);
-    std::cout << "The total size of all directories that have a size less than " << threshold << " is " << total << std::endl;
+    const std::string inputFileName = "./data/advent_of_code_day_7_input.txt";
+    const std::string snapshotFileName = "./data/advent_of_code_day_7_input.snapshot";
 
+    // Part 1 counts the folders whose folder sizes are < 100k.
     // Part 2: We know that the system has a size of 70000000 (70M). We need 30000000 (30M) for the update.
-    int sizeOfSmallesDirectoryToDelete = calculateSizeOfSmallestDirectoryToDelete(70000000, 30000000, root);
+    long long threshold = 100000;
+
+    // Parsing the log is the slow part, so only do it when there is no snapshot of this
+    // version of it yet
+    SourceStamp source;
+    if (!getSourceStamp(inputFileName, source))
+    {
+        std::cerr << "Could not find " << inputFileName << std::endl;
+        return 1;
+    }
+    FileSystemSnapshot snapshot;
+    long long total = 0;
+    long long sizeOfSmallesDirectoryToDelete = 0;
+    if (snapshot.open(snapshotFileName, source))
+    {
+        // Both answers come straight off the mapped snapshot
+        calculateSumOfDirectoriesWithSizeLessThanThreshold(snapshot.getSizeView(), threshold, total);
+        sizeOfSmallesDirectoryToDelete = calculateSizeOfSmallestDirectoryToDelete(70000000, 30000000, snapshot.getSizeView());
+    }
+    else
+    {
+        // Skip the per-line size updates; the parallel pass below fills in every size
+        TerminalOutputParser parser(false);
+        if (!readInTerminalOutput(inputFileName, parser))
+        {
+            std::cerr << "Could not read " << inputFileName << std::endl;
+            return 1;
+        }
+        FileSystem & fileSystem = parser.getFileSystem();
+        DirectorySizeSummary summary = aggregateDirectorySizes(fileSystem, threshold, 70000000, 30000000);
+
+        // Sort the directory sizes once for any other what-if queries; each is a binary search
+        DirectorySizeIndex index(fileSystem);
+        long long indexTotal = 0;
+        calculateSumOfDirectoriesWithSizeLessThanThreshold(index.getView(), threshold, indexTotal);
+        assert(indexTotal == summary.m_SumBelowThreshold);
+        assert(calculateSizeOfSmallestDirectoryToDelete(70000000, 30000000, index.getView()) == summary.m_SmallestAboveRequired);
+
+        // The live file system gives the same answers without the index
+        long long liveTotal = 0;
+        calculateSumOfDirectoriesWithSizeLessThanThreshold(fileSystem, threshold, liveTotal);
+        assert(liveTotal == summary.m_SumBelowThreshold);
+        assert(calculateSizeOfSmallestDirectoryToDelete(70000000, 30000000, fileSystem) == summary.m_SmallestAboveRequired);
+
+        total = summary.m_SumBelowThreshold;
+        sizeOfSmallesDirectoryToDelete = summary.m_SmallestAboveRequired;
+
+        // The snapshot is only a cache for the next run, so the answers don't depend on it
+        if (!writeSnapshot(fileSystem, index, source, snapshotFileName) || !snapshot.open(snapshotFileName, source))
+            std::cerr << "Could not write " << snapshotFileName << "; the log will be parsed again next time" << std::endl;
+    }
+
+    std::cout << "The total size of all directories that have a size less than " << threshold << " is " << total << std::endl;
     std::cout << "The size of the smallest directory to delete is " << sizeOfSmallesDirectoryToDelete << std::endl;
 
 
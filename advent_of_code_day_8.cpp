@@ -75,29 +75,133 @@ Consider each tree on your map. What is the highest scenic score possible for an
 #include<iostream>
 #include<algorithm>
 #include<numeric>
+#include<iterator>
+#include<stdint.h>
+#include<chrono>
+#include<random>
+#include<thread>
+#ifdef __AVX2__
+#include<immintrin.h>
+#endif
+
+// A rectangular grid stored in one contiguous row-major block
+template<typename T>
+class Grid
+{
+public:
+    Grid() : m_NumberOfRows(0), m_NumberOfColumns(0), m_Cells{} {};
+    Grid(size_t numberOfRows, size_t numberOfColumns, T value = T()) : m_NumberOfRows(numberOfRows), m_NumberOfColumns(numberOfColumns), m_Cells(numberOfRows * numberOfColumns, value) {};
+
+    size_t getNumberOfRows() const { return m_NumberOfRows; }
+    size_t getNumberOfColumns() const { return m_NumberOfColumns; }
+
+    T & operator()(size_t row, size_t column) { return m_Cells[row * m_NumberOfColumns + column]; }
+    const T & operator()(size_t row, size_t column) const { return m_Cells[row * m_NumberOfColumns + column]; }
+    T * getRow(size_t row) { return m_Cells.data() + row * m_NumberOfColumns; }
+    const T * getRow(size_t row) const { return m_Cells.data() + row * m_NumberOfColumns; }
+
+    bool operator==(const Grid & other) const
+    {
+        return m_NumberOfRows == other.m_NumberOfRows && m_NumberOfColumns == other.m_NumberOfColumns && m_Cells == other.m_Cells;
+    }
 
-std::vector<std::vector<int>> readInTreeHeightMatrix(const std::string & filename)
+private:
+    size_t m_NumberOfRows;
+    size_t m_NumberOfColumns;
+    std::vector<T> m_Cells;
+};
+
+// Tree heights are single digits, so one byte per tree is plenty
+typedef Grid<uint8_t> TreeHeightGrid;
+
+// Split [0, count) into at most numberOfThreads contiguous blocks and run
+// work(block, begin, end) on each, one thread per block. Blocks are a multiple of
+// alignment long, so threads working on neighbouring column strips don't write to the
+// same cache line.
+template<typename Work>
+void parallelFor(size_t count, unsigned numberOfThreads, size_t alignment, Work work)
 {
-    std::ifstream file(filename);
-    std::string line;
-    std::vector<std::vector<int>> treeSizeMatrix;
-    std::vector<int> treeSizeRow;
-    int treeHeight;
-    if (file.is_open())
-    {
-        while(std::getline(file, line))
+    numberOfThreads = std::max(numberOfThreads, 1u);
+    size_t blockSize = (count + numberOfThreads - 1) / numberOfThreads;
+    blockSize = std::max((blockSize + alignment - 1) / alignment * alignment, alignment);
+    std::vector<std::thread> threads;
+    size_t block = 1;
+    for (size_t begin = blockSize; begin < count; begin += blockSize)
+        threads.push_back(std::thread(work, block++, begin, std::min(begin + blockSize, count)));
+    // The calling thread takes the first block
+    work(0, 0, std::min(blockSize, count));
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
+
+unsigned defaultNumberOfThreads()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// Read a grid of single-digit tree heights, one row per line. Lines may end in "\r\n" and
+// the last one may or may not end in a newline. Every kernel relies on heights being 0-9,
+// so returns false with a description in error if the file can't be opened, a row is
+// a different length from the first one or a cell isn't a digit.
+bool readInTreeHeightGrid(const std::string & filename, TreeHeightGrid & treeHeightGrid, std::string & error)
+{
+    // Read the whole file in one go, then turn each digit into its height
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        error = "cannot open file";
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    // Find where each row starts, and check it is as long as the first one and all digits
+    std::vector<size_t> rowStarts;
+    size_t numberOfColumns = 0;
+    for (size_t lineStart = 0; lineStart < contents.size(); )
+    {
+        size_t newline = contents.find('\n', lineStart);
+        size_t lineEnd = newline == std::string::npos ? contents.size() : newline;
+        size_t nextLineStart = newline == std::string::npos ? contents.size() : newline + 1;
+        if (lineEnd > lineStart && contents[lineEnd - 1] == '\r')
+            --lineEnd;
+        size_t lineLength = lineEnd - lineStart;
+        if (rowStarts.empty())
+            numberOfColumns = lineLength;
+        if (lineLength != numberOfColumns)
+        {
+            error = "line " + std::to_string(rowStarts.size() + 1) + " has " + std::to_string(lineLength) + " trees instead of " + std::to_string(numberOfColumns);
+            return false;
+        }
+        for (size_t j = lineStart; j < lineEnd; ++j)
         {
-            // Convert each char in line into an int and push it to the matrix of tree sizes
-            for (int i = 0; i < line.size(); ++i)
+            if (contents[j] < '0' || contents[j] > '9')
             {
-                treeHeight = std::atoi(line.substr(i, 1).c_str());
-                treeSizeRow.push_back(treeHeight);
+                error = "line " + std::to_string(rowStarts.size() + 1) + " has a tree height that isn't a digit";
+                return false;
             }
-            treeSizeMatrix.push_back(treeSizeRow);
-            treeSizeRow.clear();
         }
+        rowStarts.push_back(lineStart);
+        lineStart = nextLineStart;
     }
-    file.close();
+
+    treeHeightGrid = TreeHeightGrid(rowStarts.size(), numberOfColumns);
+    for (size_t i = 0; i < rowStarts.size(); ++i)
+    {
+        const char * line = contents.data() + rowStarts[i];
+        uint8_t * row = treeHeightGrid.getRow(i);
+        for (size_t j = 0; j < numberOfColumns; ++j)
+            row[j] = line[j] - '0';
+    }
+    return true;
+}
+
+// The original nested layout, for the reference implementations below
+std::vector<std::vector<int>> toTreeSizeMatrix(const TreeHeightGrid & treeHeightGrid)
+{
+    std::vector<std::vector<int>> treeSizeMatrix(treeHeightGrid.getNumberOfRows());
+    for (size_t i = 0; i < treeHeightGrid.getNumberOfRows(); ++i)
+        treeSizeMatrix[i].assign(treeHeightGrid.getRow(i), treeHeightGrid.getRow(i) + treeHeightGrid.getNumberOfColumns());
     return treeSizeMatrix;
 }
 
@@ -173,6 +277,158 @@ std::vector<std::vector<bool>> isVisibleMatrix(std::vector<std::vector<int>> tre
     return treeVisibilityMatrix;
 }
 
+// One bit per tree, packed 64 to a word
+class VisibilityBitmap
+{
+public:
+    VisibilityBitmap(size_t numberOfRows, size_t numberOfColumns) : m_NumberOfRows(numberOfRows), m_NumberOfColumns(numberOfColumns),
+        m_WordsPerRow((numberOfColumns + 63) / 64), m_Words(numberOfRows * m_WordsPerRow, 0) {};
+
+    size_t getNumberOfRows() const { return m_NumberOfRows; }
+    size_t getNumberOfColumns() const { return m_NumberOfColumns; }
+
+    bool isVisible(size_t row, size_t column) const
+    {
+        return (m_Words[row * m_WordsPerRow + column / 64] >> (column % 64)) & 1;
+    }
+
+    // Set the bit of every tree in row whose byte in visibleBytes is non-zero
+    void setRow(size_t row, const uint8_t * visibleBytes)
+    {
+        uint64_t * words = m_Words.data() + row * m_WordsPerRow;
+        size_t j = 0;
+#ifdef __AVX2__
+        for (; j + 32 <= m_NumberOfColumns; j += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256((const __m256i *)(visibleBytes + j));
+            uint32_t isZero = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256()));
+            words[j / 64] |= (uint64_t)(~isZero) << (j % 64);
+        }
+#endif
+        for (; j < m_NumberOfColumns; ++j)
+        {
+            if (visibleBytes[j])
+                words[j / 64] |= 1ULL << (j % 64);
+        }
+    }
+
+    // Each thread counts a band of rows and the totals are added at the end
+    size_t count(unsigned numberOfThreads = defaultNumberOfThreads()) const
+    {
+        std::vector<size_t> counts(std::max(numberOfThreads, 1u), 0);
+        parallelFor(m_NumberOfRows, numberOfThreads, 1, [&](size_t block, size_t rowBegin, size_t rowEnd)
+                    {
+                        size_t total = 0;
+                        for (size_t i = rowBegin * m_WordsPerRow; i < rowEnd * m_WordsPerRow; ++i)
+                            total += __builtin_popcountll(m_Words[i]);
+                        counts[block] = total;
+                    });
+        return std::accumulate(counts.begin(), counts.end(), (size_t)0);
+    }
+
+private:
+    size_t m_NumberOfRows;
+    size_t m_NumberOfColumns;
+    size_t m_WordsPerRow;
+    std::vector<uint64_t> m_Words;
+};
+
+// Set visible(i, j) to a non-zero value for every tree in columns [columnBegin, columnEnd)
+// that is taller than all the trees to its North or all the trees to its South. Both
+// sweeps walk the grid a whole row at a time with a running maximum per column. With
+// AVX2 that is 32 columns per instruction: each byte lane keeps its own column's maximum,
+// compared with vpcmpgtb and updated with vpmaxsb. The maxima are signed bytes so that -1
+// is lower than any tree.
+void markVisibleAlongColumns(const TreeHeightGrid & treeHeightGrid, Grid<uint8_t> & visible, size_t columnBegin, size_t columnEnd)
+{
+    size_t nX = treeHeightGrid.getNumberOfRows();
+    size_t stripWidth = columnEnd - columnBegin;
+    std::vector<int8_t> tallestInColumn(stripWidth);
+    for (int sweep = 0; sweep < 2; ++sweep)
+    {
+        std::fill(tallestInColumn.begin(), tallestInColumn.end(), -1);
+        for (size_t step = 0; step < nX; ++step)
+        {
+            // North to South first, then South to North
+            size_t i = sweep == 0 ? step : nX - 1 - step;
+            const uint8_t * row = treeHeightGrid.getRow(i) + columnBegin;
+            uint8_t * visibleRow = visible.getRow(i) + columnBegin;
+            size_t j = 0;
+#ifdef __AVX2__
+            for (; j + 32 <= stripWidth; j += 32)
+            {
+                __m256i heights = _mm256_loadu_si256((const __m256i *)(row + j));
+                __m256i tallest = _mm256_loadu_si256((const __m256i *)(tallestInColumn.data() + j));
+                __m256i taller = _mm256_cmpgt_epi8(heights, tallest);
+                __m256i alreadyVisible = _mm256_loadu_si256((const __m256i *)(visibleRow + j));
+                _mm256_storeu_si256((__m256i *)(visibleRow + j), _mm256_or_si256(alreadyVisible, taller));
+                _mm256_storeu_si256((__m256i *)(tallestInColumn.data() + j), _mm256_max_epi8(heights, tallest));
+            }
+#endif
+            for (; j < stripWidth; ++j)
+            {
+                if ((int8_t)row[j] > tallestInColumn[j])
+                {
+                    visibleRow[j] = 0xFF;
+                    tallestInColumn[j] = row[j];
+                }
+            }
+        }
+    }
+}
+
+// Mark the trees in one row that are taller than everything to their West or East
+void markVisibleAlongRow(const uint8_t * row, uint8_t * visibleRow, size_t nY)
+{
+    // Heights are 0-9, so -1 is lower than any tree
+    int tallestFromWest = -1;
+    for (size_t j = 0; j < nY && tallestFromWest < 9; ++j)
+    {
+        if (row[j] > tallestFromWest)
+        {
+            visibleRow[j] = 0xFF;
+            tallestFromWest = row[j];
+        }
+    }
+    int tallestFromEast = -1;
+    for (size_t j = nY; j-- > 0 && tallestFromEast < 9;)
+    {
+        if (row[j] > tallestFromEast)
+        {
+            visibleRow[j] = 0xFF;
+            tallestFromEast = row[j];
+        }
+    }
+}
+
+// Same result as isVisibleMatrix, but instead of rescanning every tree's row and column
+// keep a running maximum while sweeping the grid from each of the four sides. That is
+// O(nX * nY) in total with nothing allocated per tree.
+//
+// The North and South sweeps are split into column strips, one per thread. The West and
+// East sweeps, and packing the result into the bitmap, are split into bands of rows.
+VisibilityBitmap visibilityBitmap(const TreeHeightGrid & treeHeightGrid, unsigned numberOfThreads = defaultNumberOfThreads())
+{
+    size_t nX = treeHeightGrid.getNumberOfRows();
+    size_t nY = treeHeightGrid.getNumberOfColumns();
+    Grid<uint8_t> visible(nX, nY, 0);
+    parallelFor(nY, numberOfThreads, 64, [&](size_t, size_t columnBegin, size_t columnEnd)
+                {
+                    markVisibleAlongColumns(treeHeightGrid, visible, columnBegin, columnEnd);
+                });
+
+    VisibilityBitmap bitmap(nX, nY);
+    parallelFor(nX, numberOfThreads, 1, [&](size_t, size_t rowBegin, size_t rowEnd)
+                {
+                    for (size_t i = rowBegin; i < rowEnd; ++i)
+                    {
+                        markVisibleAlongRow(treeHeightGrid.getRow(i), visible.getRow(i), nY);
+                        bitmap.setRow(i, visible.getRow(i));
+                    }
+                });
+    return bitmap;
+}
+
  // Part 2
 
  int getScenicScore(int x, int y, int nX, int nY, const std::vector<std::vector<int>> & treeSizeMatrix)
@@ -251,35 +507,412 @@ std::vector<std::vector<bool>> isVisibleMatrix(std::vector<std::vector<int>> tre
     return scenicMatrix;
 }
 
-int main()
+// Trees that are still waiting for a tree at least as tall to block their view. Heights
+// strictly decrease from the bottom of the stack to the top, and there are only ten
+// heights, so the stack never holds more than ten trees.
+struct BlockerStack
+{
+    BlockerStack() : m_Size(0) {};
+
+    void push(int position, int height, long long partialScore)
+    {
+        m_Positions[m_Size] = position;
+        m_Heights[m_Size] = height;
+        m_PartialScores[m_Size] = partialScore;
+        ++m_Size;
+    }
+
+    int m_Positions[10];
+    int m_Heights[10];
+    // Product of the viewing distances found so far (only used by the column stacks)
+    long long m_PartialScores[10];
+    int m_Size;
+};
+
+// The maximum of scenicScoreMatrix without building the matrix or walking outwards from
+// every tree. A tree's view towards the start of a row or column stops at the nearest
+// earlier tree that is at least as tall: that's the top of the stack once the shorter
+// trees are popped. Its view the other way stops at the first later tree at least as
+// tall, which is the tree that pops it off the stack.
+//
+// Each row is swept once for West and East. The North and South distances come from
+// one stack per column that is advanced a row at a time, and a tree's score is complete
+// as soon as its South distance is known. This is O(nX * nY) overall.
+long long maxScenicScore(const TreeHeightGrid & treeHeightGrid)
+{
+    int nX = treeHeightGrid.getNumberOfRows();
+    int nY = treeHeightGrid.getNumberOfColumns();
+    long long maxScore = 0;
+
+    // West * East viewing distance for the trees in the current row
+    std::vector<long long> horizontalScores(nY);
+    std::vector<BlockerStack> columnStacks(nY);
+
+    for (int i = 0; i < nX; ++i)
+    {
+        const uint8_t * row = treeHeightGrid.getRow(i);
+
+        // West and East
+        BlockerStack rowStack;
+        for (int j = 0; j < nY; ++j)
+        {
+            int treeSize = row[j];
+            while (rowStack.m_Size > 0 && rowStack.m_Heights[rowStack.m_Size - 1] < treeSize)
+            {
+                int blocked = rowStack.m_Positions[--rowStack.m_Size];
+                horizontalScores[blocked] *= j - blocked;
+            }
+            // Nothing as tall to the West means we can see all the way to the edge
+            horizontalScores[j] = rowStack.m_Size > 0 ? j - rowStack.m_Positions[rowStack.m_Size - 1] : j;
+            while (rowStack.m_Size > 0 && rowStack.m_Heights[rowStack.m_Size - 1] == treeSize)
+            {
+                int blocked = rowStack.m_Positions[--rowStack.m_Size];
+                horizontalScores[blocked] *= j - blocked;
+            }
+            rowStack.push(j, treeSize, 0);
+        }
+        while (rowStack.m_Size > 0)
+        {
+            int blocked = rowStack.m_Positions[--rowStack.m_Size];
+            horizontalScores[blocked] *= nY - 1 - blocked;
+        }
+
+        // North and South
+        for (int j = 0; j < nY; ++j)
+        {
+            BlockerStack & columnStack = columnStacks[j];
+            int treeSize = row[j];
+            while (columnStack.m_Size > 0 && columnStack.m_Heights[columnStack.m_Size - 1] < treeSize)
+            {
+                --columnStack.m_Size;
+                long long score = columnStack.m_PartialScores[columnStack.m_Size] * (i - columnStack.m_Positions[columnStack.m_Size]);
+                maxScore = std::max(maxScore, score);
+            }
+            int northViewingDistance = columnStack.m_Size > 0 ? i - columnStack.m_Positions[columnStack.m_Size - 1] : i;
+            while (columnStack.m_Size > 0 && columnStack.m_Heights[columnStack.m_Size - 1] == treeSize)
+            {
+                --columnStack.m_Size;
+                long long score = columnStack.m_PartialScores[columnStack.m_Size] * (i - columnStack.m_Positions[columnStack.m_Size]);
+                maxScore = std::max(maxScore, score);
+            }
+            columnStack.push(i, treeSize, horizontalScores[j] * northViewingDistance);
+        }
+    }
+
+    // Whatever is left can see all the way to the South edge
+    for (int j = 0; j < nY; ++j)
+    {
+        BlockerStack & columnStack = columnStacks[j];
+        while (columnStack.m_Size > 0)
+        {
+            --columnStack.m_Size;
+            long long score = columnStack.m_PartialScores[columnStack.m_Size] * (nX - 1 - columnStack.m_Positions[columnStack.m_Size]);
+            maxScore = std::max(maxScore, score);
+        }
+    }
+    return maxScore;
+}
+
+// North viewing distances for one row. distancesToTaller[k * nY + j] says how many rows
+// back the last tree in column j at least k tall was (or how far the edge is), so a tree
+// of height h reads its viewing distance straight out of the table for h. The table is
+// then reset to 1 for every k <= h and incremented for the rest, ready for the next row.
+// With AVX2 that runs 8 columns at a time in 32-bit lanes, picking each lane's entry
+// with a compare and blend per height.
+void northViewingDistances(const uint8_t * row, uint32_t * distancesToTaller, uint32_t * north, size_t nY)
 {
-    std::vector<std::vector<int>> treeSizeMatrix = readInTreeHeightMatrix("./data/advent_of_code_day_8_input.txt");
-    assert(treeSizeMatrix.size() == 99);
-    assert(treeSizeMatrix[0].size() == 99);
-    std::vector<std::vector<bool>> treeVisibilityMatrix = isVisibleMatrix(treeSizeMatrix);
+    size_t j = 0;
+#ifdef __AVX2__
+    const __m256i one = _mm256_set1_epi32(1);
+    for (; j + 8 <= nY; j += 8)
+    {
+        __m256i heights = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(row + j)));
+        __m256i viewingDistance = _mm256_setzero_si256();
+        for (int k = 0; k < 10; ++k)
+        {
+            __m256i level = _mm256_set1_epi32(k);
+            uint32_t * entry = distancesToTaller + k * nY + j;
+            __m256i distance = _mm256_loadu_si256((const __m256i *)entry);
+            viewingDistance = _mm256_blendv_epi8(viewingDistance, distance, _mm256_cmpeq_epi32(heights, level));
+            // Lanes where k > h keep counting; the others are now blocked by this tree
+            __m256i shorter = _mm256_cmpgt_epi32(level, heights);
+            _mm256_storeu_si256((__m256i *)entry, _mm256_blendv_epi8(one, _mm256_add_epi32(distance, one), shorter));
+        }
+        _mm256_storeu_si256((__m256i *)(north + j), viewingDistance);
+    }
+#endif
+    for (; j < nY; ++j)
+    {
+        int treeSize = row[j];
+        north[j] = distancesToTaller[treeSize * nY + j];
+        for (int k = 0; k < 10; ++k)
+        {
+            uint32_t & entry = distancesToTaller[k * nY + j];
+            entry = k <= treeSize ? 1 : entry + 1;
+        }
+    }
+}
 
-    int numberOfTreesVisible = 0;
-    for (int i = 0; i < treeVisibilityMatrix.size(); ++i)
+// West * East viewing distances for one row, using the same table of distances back to
+// the last tree of each height as the column kernel. westEast needs nY entries.
+void viewingDistancesAlongRow(const uint8_t * row, uint64_t * westEast, size_t nY)
+{
+    uint32_t distancesToTaller[10] = {0};
+    for (size_t j = 0; j < nY; ++j)
+    {
+        int treeSize = row[j];
+        westEast[j] = distancesToTaller[treeSize];
+        for (int k = 0; k < 10; ++k)
+            distancesToTaller[k] = k <= treeSize ? 1 : distancesToTaller[k] + 1;
+    }
+    std::fill(distancesToTaller, distancesToTaller + 10, 0);
+    for (size_t j = nY; j-- > 0;)
     {
-        for (int j = 0; j < treeVisibilityMatrix[i].size(); ++j)
+        int treeSize = row[j];
+        westEast[j] *= distancesToTaller[treeSize];
+        for (int k = 0; k < 10; ++k)
+            distancesToTaller[k] = k <= treeSize ? 1 : distancesToTaller[k] + 1;
+    }
+}
+
+// Marks a column with no tree tall enough in a BandSummary
+const long long NO_ROW = -1;
+
+// For a band of rows, every height k and every column j: the first and last row of the
+// band with a tree at least k tall in column j, or NO_ROW. Entries are at [k * nY + j].
+struct BandSummary
+{
+    BandSummary(size_t nY) : m_FirstAtLeast(10 * nY, NO_ROW), m_LastAtLeast(10 * nY, NO_ROW) {};
+    std::vector<long long> m_FirstAtLeast;
+    std::vector<long long> m_LastAtLeast;
+};
+
+// maxScenicScore built from the sweep kernels, for grids too big for one core. The rows
+// are split into one band per thread and each band is streamed top to bottom, so memory
+// grows with the width of the grid and the number of threads, never with its height.
+//
+// A band can't see the trees above or below it, so first each thread summarises its
+// band: per column and height, the first and last row with a tree at least that tall.
+// Chaining the summaries gives every band the nearest such rows above and below it.
+// Then each thread sweeps its band again. West * East comes from the row kernel, North
+// from the column table seeded with the rows above the band, and South from a
+// BlockerStack per column like maxScenicScore's. Trees still on a stack at the bottom of
+// the band look up their South blocker in the rows below. Each thread keeps its best
+// score, and the maxima are reduced at the end.
+long long maxScenicScoreVectorized(const TreeHeightGrid & treeHeightGrid, unsigned numberOfThreads = defaultNumberOfThreads())
+{
+    size_t nX = treeHeightGrid.getNumberOfRows();
+    size_t nY = treeHeightGrid.getNumberOfColumns();
+    size_t numberOfBands = std::max(numberOfThreads, 1u);
+    std::vector<BandSummary> bands(numberOfBands, BandSummary(nY));
+    parallelFor(nX, numberOfThreads, 1, [&](size_t band, size_t rowBegin, size_t rowEnd)
+                {
+                    // Scan in from each end of the band with a running maximum per column.
+                    // Every entry is written once, and the scan stops as soon as every
+                    // column has met a 9, which in practice is only a few rows in.
+                    BandSummary & summary = bands[band];
+                    std::vector<int> tallestInColumn(nY);
+                    for (int fromEnd = 0; fromEnd < 2; ++fromEnd)
+                    {
+                        std::vector<long long> & rows = fromEnd == 0 ? summary.m_FirstAtLeast : summary.m_LastAtLeast;
+                        std::fill(tallestInColumn.begin(), tallestInColumn.end(), -1);
+                        size_t columnsLeft = nY;
+                        for (size_t step = 0; step < rowEnd - rowBegin && columnsLeft > 0; ++step)
+                        {
+                            size_t i = fromEnd == 0 ? rowBegin + step : rowEnd - 1 - step;
+                            const uint8_t * row = treeHeightGrid.getRow(i);
+                            for (size_t j = 0; j < nY; ++j)
+                            {
+                                if (row[j] <= tallestInColumn[j])
+                                    continue;
+                                for (int k = tallestInColumn[j] + 1; k <= row[j]; ++k)
+                                    rows[k * nY + j] = i;
+                                tallestInColumn[j] = row[j];
+                                if (row[j] == 9)
+                                    --columnsLeft;
+                            }
+                        }
+                    }
+                });
+
+    // Turn each band's summary into the nearest rows outside it: m_LastAtLeast becomes
+    // the last row above the band, m_FirstAtLeast the first row below it
+    std::vector<long long> nearest(10 * nY, NO_ROW);
+    for (size_t band = 0; band < numberOfBands; ++band)
+    {
+        std::vector<long long> & last = bands[band].m_LastAtLeast;
+        for (size_t entry = 0; entry < last.size(); ++entry)
         {
-            numberOfTreesVisible += int(treeVisibilityMatrix[i][j]);
+            long long inBand = last[entry];
+            last[entry] = nearest[entry];
+            if (inBand != NO_ROW)
+                nearest[entry] = inBand;
         }
     }
+    std::fill(nearest.begin(), nearest.end(), NO_ROW);
+    for (size_t band = numberOfBands; band-- > 0;)
+    {
+        std::vector<long long> & first = bands[band].m_FirstAtLeast;
+        for (size_t entry = 0; entry < first.size(); ++entry)
+        {
+            long long inBand = first[entry];
+            first[entry] = nearest[entry];
+            if (inBand != NO_ROW)
+                nearest[entry] = inBand;
+        }
+    }
+
+    std::vector<long long> maxScores(numberOfBands, 0);
+    parallelFor(nX, numberOfThreads, 1, [&](size_t band, size_t rowBegin, size_t rowEnd)
+                {
+                    const std::vector<long long> & rowsAbove = bands[band].m_LastAtLeast;
+                    const std::vector<long long> & rowsBelow = bands[band].m_FirstAtLeast;
+                    std::vector<uint32_t> distancesToTaller(10 * nY);
+                    for (size_t entry = 0; entry < distancesToTaller.size(); ++entry)
+                        distancesToTaller[entry] = rowsAbove[entry] == NO_ROW ? rowBegin : rowBegin - rowsAbove[entry];
+                    std::vector<uint64_t> westEast(nY);
+                    std::vector<uint32_t> north(nY);
+                    std::vector<BlockerStack> columnStacks(nY);
+                    long long maxScore = 0;
+                    for (size_t i = rowBegin; i < rowEnd; ++i)
+                    {
+                        const uint8_t * row = treeHeightGrid.getRow(i);
+                        viewingDistancesAlongRow(row, westEast.data(), nY);
+                        northViewingDistances(row, distancesToTaller.data(), north.data(), nY);
+                        for (size_t j = 0; j < nY; ++j)
+                        {
+                            // This tree blocks the South view of every tree above it that
+                            // isn't taller
+                            BlockerStack & columnStack = columnStacks[j];
+                            int treeSize = row[j];
+                            while (columnStack.m_Size > 0 && columnStack.m_Heights[columnStack.m_Size - 1] <= treeSize)
+                            {
+                                --columnStack.m_Size;
+                                long long score = columnStack.m_PartialScores[columnStack.m_Size] * (long long)(i - columnStack.m_Positions[columnStack.m_Size]);
+                                maxScore = std::max(maxScore, score);
+                            }
+                            columnStack.push(i, treeSize, (long long)(westEast[j] * north[j]));
+                        }
+                    }
+
+                    // The rest are blocked below the band, or can see the South edge
+                    for (size_t j = 0; j < nY; ++j)
+                    {
+                        BlockerStack & columnStack = columnStacks[j];
+                        while (columnStack.m_Size > 0)
+                        {
+                            --columnStack.m_Size;
+                            long long blocker = rowsBelow[columnStack.m_Heights[columnStack.m_Size] * nY + j];
+                            long long southViewingDistance = (blocker == NO_ROW ? nX - 1 : blocker) - columnStack.m_Positions[columnStack.m_Size];
+                            maxScore = std::max(maxScore, columnStack.m_PartialScores[columnStack.m_Size] * southViewingDistance);
+                        }
+                    }
+                    maxScores[band] = maxScore;
+                });
+    return *std::max_element(maxScores.begin(), maxScores.end());
+}
 
+// Average wall-clock seconds per call of function
+template<typename Function>
+double timeInSeconds(Function function, int repetitions)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i)
+        function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+// Compare the original per-tree scans with the sweep kernels on random grids
+void runBenchmarks()
+{
+#ifdef __AVX2__
+    std::cout << "AVX2 kernels enabled" << std::endl;
+#else
+    std::cout << "AVX2 kernels disabled (compile with -mavx2 to enable them)" << std::endl;
+#endif
+    std::cout << "Running on " << defaultNumberOfThreads() << " thread(s)" << std::endl;
+    std::mt19937 generator(2022);
+    const size_t sizes[] = {99, 500, 4000};
+    for (size_t n : sizes)
+    {
+        TreeHeightGrid treeHeightGrid(n, n);
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < n; ++j)
+                treeHeightGrid(i, j) = generator() % 10;
+
+        size_t visibleCount = 0;
+        long long bestScore = 0;
+        long long vectorizedBestScore = 0;
+        int repetitions = n < 1000 ? 20 : 3;
+        std::cout << n << "x" << n << " grid:" << std::endl;
+        // The per-tree scans are O(n^3), so skip them on the big grid
+        if (n <= 500)
+        {
+            std::vector<std::vector<int>> treeSizeMatrix = toTreeSizeMatrix(treeHeightGrid);
+            std::cout << "  isVisibleMatrix          " << timeInSeconds([&]() { isVisibleMatrix(treeSizeMatrix); }, 1) << " s" << std::endl;
+            std::cout << "  scenicScoreMatrix        " << timeInSeconds([&]() { scenicScoreMatrix(treeSizeMatrix); }, 1) << " s" << std::endl;
+        }
+        std::cout << "  visibilityBitmap         " << timeInSeconds([&]() { visibleCount = visibilityBitmap(treeHeightGrid).count(); }, repetitions) << " s" << std::endl;
+        std::cout << "  maxScenicScore           " << timeInSeconds([&]() { bestScore = maxScenicScore(treeHeightGrid); }, repetitions) << " s" << std::endl;
+        std::cout << "  maxScenicScoreVectorized " << timeInSeconds([&]() { vectorizedBestScore = maxScenicScoreVectorized(treeHeightGrid); }, repetitions) << " s" << std::endl;
+        assert(vectorizedBestScore == bestScore);
+        std::cout << "  (" << visibleCount << " visible, best scenic score " << bestScore << ")" << std::endl;
+    }
+}
+
+// Usage: advent_of_code_day_8 [grid file | --benchmark]
+int main(int argc, char ** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--benchmark")
+    {
+        runBenchmarks();
+        return 0;
+    }
+
+    std::string filename = argc > 1 ? argv[1] : "./data/advent_of_code_day_8_input.txt";
+    TreeHeightGrid treeHeightGrid;
+    std::string error;
+    if (!readInTreeHeightGrid(filename, treeHeightGrid, error))
+    {
+        std::cout << "Could not read " << filename << ": " << error << std::endl;
+        return 1;
+    }
+    if (treeHeightGrid.getNumberOfRows() == 0 || treeHeightGrid.getNumberOfColumns() == 0)
+    {
+        std::cout << "No trees in " << filename << std::endl;
+        return 1;
+    }
+    VisibilityBitmap visible = visibilityBitmap(treeHeightGrid);
+    size_t numberOfTreesVisible = visible.count();
     std::cout << "The number of trees visible from outside the grid is " << numberOfTreesVisible << std::endl;
 
     // Part 2
-    std::vector<std::vector<int>> scenicMatrix = scenicScoreMatrix(treeSizeMatrix);
-    int maxScenicScore = 0;
-    for (int i = 0; i < scenicMatrix.size(); ++i)
+    long long bestScenicScore = maxScenicScoreVectorized(treeHeightGrid);
+    std::cout << "The spot with the maximum scenic score has " << bestScenicScore << "." << std::endl;
+
+    // The original per-tree scans are O(n^3), so only check against them on small grids
+    if (treeHeightGrid.getNumberOfRows() * treeHeightGrid.getNumberOfColumns() <= 100000)
     {
-        for (int j = 0; j < scenicMatrix[i].size(); ++j)
+        std::vector<std::vector<int>> treeSizeMatrix = toTreeSizeMatrix(treeHeightGrid);
+        std::vector<std::vector<bool>> treeVisibilityMatrix = isVisibleMatrix(treeSizeMatrix);
+        for (size_t i = 0; i < treeVisibilityMatrix.size(); ++i)
         {
-            if (scenicMatrix[i][j] > maxScenicScore)
-                maxScenicScore = scenicMatrix[i][j];
+            for (size_t j = 0; j < treeVisibilityMatrix[i].size(); ++j)
+                assert(visible.isVisible(i, j) == treeVisibilityMatrix[i][j]);
+        }
+
+        assert(maxScenicScore(treeHeightGrid) == bestScenicScore);
+        std::vector<std::vector<int>> scenicMatrix = scenicScoreMatrix(treeSizeMatrix);
+        int maxOfScenicMatrix = 0;
+        for (int i = 0; i < scenicMatrix.size(); ++i)
+        {
+            for (int j = 0; j < scenicMatrix[i].size(); ++j)
+            {
+                if (scenicMatrix[i][j] > maxOfScenicMatrix)
+                    maxOfScenicMatrix = scenicMatrix[i][j];
+            }
         }
+        assert(bestScenicScore == maxOfScenicMatrix);
     }
-    std::cout << "The spot with the maximum scenic score has " << maxScenicScore << "." << std::endl;
     return 0;
 }
\ No newline at end of file
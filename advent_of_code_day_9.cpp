@@ -245,8 +245,19 @@ Simulate your complete hypothetical series of motions. How many positions does t
 #include<string>
 #include<vector>
 #include<fstream>
-#include<map>
 #include<assert.h>
+#include<stdint.h>
+#include<algorithm>
+#include<cstdlib>
+#include<climits>
+#include<cctype>
+#include<chrono>
+#include<random>
+#include<future>
+#include<thread>
+#include<atomic>
+#include<dirent.h>
+#include<sys/stat.h>
 
 std::vector<std::string> readInstructions(const std::string& filename)
 {
@@ -264,147 +275,493 @@ std::vector<std::string> readInstructions(const std::string& filename)
   return vectorToReturn;
 }
 
-std::vector<char> parseInstructions(std::vector<std::string> instructions)
+// One line of the puzzle input: move the head m_Steps times in m_Direction
+struct Motion
 {
-  std::vector<char> vectorToReturn;
+  Motion(char direction, int steps) : m_Direction(direction), m_Steps(steps) {};
+  char m_Direction;
+  int m_Steps;
+};
+
+std::vector<Motion> parseInstructions(std::vector<std::string> instructions)
+{
+  std::vector<Motion> vectorToReturn;
   for (auto & line : instructions)
   {
+    if (line.empty())
+      continue;
     char direction = line.at(0);
     size_t spacePosition = line.find(" ");
     int repetitions = std::atoi(line.substr(spacePosition + 1).c_str());
-    for (int i = 0; i < repetitions; ++i)
-      vectorToReturn.push_back(direction);
+    vectorToReturn.push_back(Motion(direction, repetitions));
   }
   return vectorToReturn;
 }
 
-class Knot
+// The change in (x, y) for one step in direction
+std::pair<int, int> getStep(char direction)
+{
+  if (direction == 'R')
+    return std::pair<int, int>(1, 0);
+  else if (direction == 'L')
+    return std::pair<int, int>(-1, 0);
+  else if (direction == 'U')
+    return std::pair<int, int>(0, 1);
+  else
+    return std::pair<int, int>(0, -1);
+}
+
+int sign(int value)
+{
+  return (value > 0) - (value < 0);
+}
+
+// Marks an unused slot in VisitedSet. It is the packed key of (INT_MIN, INT_MIN), which no
+// knot gets anywhere near.
+const uint64_t EMPTY_POSITION_KEY = 0x8000000080000000ull;
+
+uint64_t packPosition(int x, int y)
+{
+  return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+// The set of positions a knot has visited. Positions are packed into a single 64-bit key
+// and stored in an open-addressing table with linear probing, so an insert is a multiply,
+// a shift and usually one probe, with nothing allocated per position. The table doubles
+// whenever it gets half full.
+class VisitedSet
 {
   public:
-    Knot() : m_X(0), m_Y(0) {};
-    void applyMovement(char direction)
+    VisitedSet() : m_Keys(1024, EMPTY_POSITION_KEY), m_Shift(64 - 10), m_Size(0) {};
+    // Returns true if the position had not been visited before
+    bool insert(int x, int y)
+    {
+      uint64_t key = packPosition(x, y);
+      assert(key != EMPTY_POSITION_KEY);
+      if (2 * (m_Size + 1) > m_Keys.size())
+        grow();
+      size_t slot = findSlot(key);
+      if (m_Keys[slot] == key)
+        return false;
+      m_Keys[slot] = key;
+      ++m_Size;
+      return true;
+    }
+    bool contains(int x, int y) const
+    {
+      return m_Keys[findSlot(packPosition(x, y))] != EMPTY_POSITION_KEY;
+    }
+    size_t size() const { return m_Size;};
+    // Forget every position but keep the table, so the set can be refilled without allocating
+    void clear()
     {
-      if (direction == 'R')
-        ++m_X;
-      else if (direction == 'L')
-        --m_X;
-      else if (direction == 'U')
-        ++m_Y;
-      else
-        --m_Y;
+      std::fill(m_Keys.begin(), m_Keys.end(), EMPTY_POSITION_KEY);
+      m_Size = 0;
     }
-  int getXPosition() { return m_X;};
-  int getYPosition() { return m_Y;};
-  std::pair<int, int> getXYPosition(){ return std::pair<int, int>(m_X, m_Y);}
   private:
-    int m_X;
-    int m_Y;
+    // The slot holding key, or the empty slot where it would go
+    size_t findSlot(uint64_t key) const
+    {
+      size_t mask = m_Keys.size() - 1;
+      // Fibonacci hashing: the top bits of the product depend on every bit of the key
+      size_t slot = (key * 0x9E3779B97F4A7C15ull) >> m_Shift;
+      while (m_Keys[slot] != key && m_Keys[slot] != EMPTY_POSITION_KEY)
+        slot = (slot + 1) & mask;
+      return slot;
+    }
+    void grow()
+    {
+      std::vector<uint64_t> oldKeys(2 * m_Keys.size(), EMPTY_POSITION_KEY);
+      oldKeys.swap(m_Keys);
+      --m_Shift;
+      for (auto & key : oldKeys)
+      {
+        if (key != EMPTY_POSITION_KEY)
+          m_Keys[findSlot(key)] = key;
+      }
+    }
+    std::vector<uint64_t> m_Keys;
+    int m_Shift;
+    size_t m_Size;
 };
 
-std::pair<int, int> getRelativePosition(Knot head, Knot tail)
+// A rope of any number of knots, with the head at knot 0. The coordinates are kept in
+// one array of x positions and one of y positions rather than as an array of knots.
+// Each tracked knot gets a VisitedSet of every position it has been in. A shorter rope
+// moves exactly like the first knots of a longer one, so tracking several knots answers
+// several rope lengths in a single pass.
+class RopeSimulator
 {
-  return std::pair<int, int>(tail.getXPosition() - head.getXPosition(), tail.getYPosition() - head.getYPosition());
+  public:
+    // Track just the tail
+    RopeSimulator(size_t numberOfKnots) : RopeSimulator(numberOfKnots, std::vector<size_t>(1, numberOfKnots - 1)) {};
+    RopeSimulator(size_t numberOfKnots, const std::vector<size_t> & trackedKnots) : m_Xs(numberOfKnots, 0), m_Ys(numberOfKnots, 0), m_VisitedSetIndex(numberOfKnots, -1)
+    {
+      assert(numberOfKnots > 0);
+      for (auto & knot : trackedKnots)
+      {
+        assert(knot < numberOfKnots);
+        if (isTracked(knot))
+          continue;
+        m_VisitedSetIndex[knot] = m_VisitedSets.size();
+        m_VisitedSets.push_back(VisitedSet());
+        recordPosition(knot);
+      }
+    };
+
+    // Each motion is simulated step by step only until the whole rope lies in a straight
+    // line behind the head. From then on every knot just moves along with the head, so
+    // the rest of the motion is a single jump for each knot, and each tracked knot visits
+    // the cells in between.
+    void applyMotion(const Motion & motion)
+    {
+      std::pair<int, int> step = getStep(motion.m_Direction);
+      size_t numberOfKnots = m_Xs.size();
+      // Knots [0, numberInLine) are one step apart in a line behind the head. A line like
+      // that moves rigidly with the head, so it only ever grows during the motion.
+      size_t numberInLine = 1;
+      int stepsTaken = 0;
+      for (; stepsTaken < motion.m_Steps && numberInLine < numberOfKnots; ++stepsTaken)
+      {
+        moveHead(step.first, step.second);
+        while (numberInLine < numberOfKnots
+               && m_Xs[numberInLine - 1] - m_Xs[numberInLine] == step.first
+               && m_Ys[numberInLine - 1] - m_Ys[numberInLine] == step.second)
+          ++numberInLine;
+      }
+
+      int stepsLeft = motion.m_Steps - stepsTaken;
+      if (stepsLeft > 0)
+      {
+        for (size_t knot = 0; knot < numberOfKnots; ++knot)
+        {
+          m_Xs[knot] += stepsLeft * step.first;
+          m_Ys[knot] += stepsLeft * step.second;
+          if (isTracked(knot))
+          {
+            VisitedSet & visited = m_VisitedSets[m_VisitedSetIndex[knot]];
+            for (int i = stepsLeft - 1; i >= 0; --i)
+              visited.insert(m_Xs[knot] - i * step.first, m_Ys[knot] - i * step.second);
+          }
+        }
+      }
+    }
+    void applyMotions(const std::vector<Motion> & motions)
+    {
+      for (auto & motion : motions)
+        applyMotion(motion);
+    }
+
+    size_t getNumberOfKnots() const { return m_Xs.size();};
+    int getXPosition(size_t knot) const { return m_Xs[knot];};
+    int getYPosition(size_t knot) const { return m_Ys[knot];};
+    bool isTracked(size_t knot) const { return m_VisitedSetIndex[knot] >= 0;};
+    // Put every knot back at the start and forget where the tracked knots have been. The
+    // visited sets keep their tables, so reusing a simulator for another run doesn't
+    // allocate them again.
+    void reset()
+    {
+      std::fill(m_Xs.begin(), m_Xs.end(), 0);
+      std::fill(m_Ys.begin(), m_Ys.end(), 0);
+      for (auto & visited : m_VisitedSets)
+        visited.clear();
+      for (size_t knot = 0; knot < m_Xs.size(); ++knot)
+        recordPosition(knot);
+    }
+    // The number of different positions a tracked knot has been in, counting where it started
+    size_t getNumberOfPositionsVisited(size_t knot) const
+    {
+      assert(isTracked(knot));
+      return m_VisitedSets[m_VisitedSetIndex[knot]].size();
+    }
+
+  private:
+    // Move the head one step and let the rest of the rope follow. Once a knot stays put,
+    // nothing behind it can move either, so the rest of the rope is skipped.
+    void moveHead(int dx, int dy)
+    {
+      m_Xs[0] += dx;
+      m_Ys[0] += dy;
+      recordPosition(0);
+      for (size_t knot = 1; knot < m_Xs.size(); ++knot)
+      {
+        // Once the knot ahead is more than one step away in either direction, move one
+        // step towards it along each axis where they differ
+        int distanceX = m_Xs[knot - 1] - m_Xs[knot];
+        int distanceY = m_Ys[knot - 1] - m_Ys[knot];
+        if (std::max(std::abs(distanceX), std::abs(distanceY)) <= 1)
+          break;
+        m_Xs[knot] += sign(distanceX);
+        m_Ys[knot] += sign(distanceY);
+        recordPosition(knot);
+      }
+    }
+    void recordPosition(size_t knot)
+    {
+      if (m_VisitedSetIndex[knot] >= 0)
+        m_VisitedSets[m_VisitedSetIndex[knot]].insert(m_Xs[knot], m_Ys[knot]);
+    }
+
+    std::vector<int> m_Xs;
+    std::vector<int> m_Ys;
+    // Index into m_VisitedSets for each knot, or -1 if the knot isn't tracked
+    std::vector<int> m_VisitedSetIndex;
+    std::vector<VisitedSet> m_VisitedSets;
+};
+
+// Random motions adding up to numberOfSteps, of 1 to 20 steps each like the puzzle input
+std::vector<Motion> randomMotions(size_t numberOfSteps, std::mt19937 & generator)
+{
+  const char directions[] = {'R', 'L', 'U', 'D'};
+  std::vector<Motion> motions;
+  for (size_t stepsSoFar = 0; stepsSoFar < numberOfSteps;)
+  {
+    char direction = directions[generator() % 4];
+    int steps = std::min<size_t>(1 + generator() % 20, numberOfSteps - stepsSoFar);
+    motions.push_back(Motion(direction, steps));
+    stepsSoFar += steps;
+  }
+  return motions;
 }
 
-std::vector<char> getTailMovementPattern(std::pair<int, int> relativePosition)
+// Time ropes of 10 and 1000 knots over the same random motions
+void runBenchmarks(size_t numberOfSteps)
 {
-  std::vector<char> vectorToReturn;
-  std::map<std::pair<int, int>, std::vector<char>> patternLibrary;
-  patternLibrary.insert({std::pair<int, int>(0, 0), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(1, 0), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(-1, 0), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(0, 1), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(0, -1), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(1, 1), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(1, -1), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(-1, 1), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(-1, -1), std::vector<char>()});
-  patternLibrary.insert({std::pair<int, int>(2, 0), std::vector<char>{'L'}});
-  patternLibrary.insert({std::pair<int, int>(-2, 0), std::vector<char>{'R'}});
-  patternLibrary.insert({std::pair<int, int>(0, 2), std::vector<char>{'D'}});
-  patternLibrary.insert({std::pair<int, int>(0, -2), std::vector<char>{'U'}});
-  patternLibrary.insert({std::pair<int, int>(2, 1), std::vector<char>{'L', 'D'}});
-  patternLibrary.insert({std::pair<int, int>(2, -1), std::vector<char>{'L', 'U'}});
-  patternLibrary.insert({std::pair<int, int>(-2, 1), std::vector<char>{'R', 'D'}});
-  patternLibrary.insert({std::pair<int, int>(-2, -1), std::vector<char>{'R', 'U'}});
-  patternLibrary.insert({std::pair<int, int>(1, 2), std::vector<char>{'L', 'D'}});
-  patternLibrary.insert({std::pair<int, int>(1, -2), std::vector<char>{'L', 'U'}});
-  patternLibrary.insert({std::pair<int, int>(-1, 2), std::vector<char>{'R', 'D'}});
-  patternLibrary.insert({std::pair<int, int>(-1, -2), std::vector<char>{'R', 'U'}});
-  // Part 2: Need to entertain what happens if they are two apart
-  patternLibrary.insert({std::pair<int, int>(-2, -2), std::vector<char>{'R', 'U'}});
-  patternLibrary.insert({std::pair<int, int>(2, 2), std::vector<char>{'L', 'D'}});
-  patternLibrary.insert({std::pair<int, int>(-2, 2), std::vector<char>{'R', 'D'}});
-  patternLibrary.insert({std::pair<int, int>(2, -2), std::vector<char>{'L', 'U'}});
-
-  std::map<std::pair<int, int>, std::vector<char>>::iterator it = patternLibrary.find(relativePosition);
-  assert (it != patternLibrary.end());
-  vectorToReturn = it->second;
-  return vectorToReturn;
+  std::mt19937 generator(2022);
+  std::vector<Motion> motions = randomMotions(numberOfSteps, generator);
+  const size_t knotCounts[] = {10, 1000};
+  for (auto & numberOfKnots : knotCounts)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RopeSimulator rope(numberOfKnots);
+    rope.applyMotions(motions);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << numberOfKnots << " knots, " << numberOfSteps << " steps: " << seconds << " s, "
+              << numberOfSteps / seconds << " steps/s (tail visited " << rope.getNumberOfPositionsVisited(numberOfKnots - 1) << " positions)" << std::endl;
+  }
 }
 
-int main()
+// The motion files to run in a batch: every regular file in path if it is a directory,
+// otherwise every line of path, which is read as a manifest of file names. Returns false
+// if path can't be read.
+bool listMotionFiles(const std::string & path, std::vector<std::string> & files)
 {
-  std::vector<std::string> instructions = readInstructions("./data/advent_of_code_day_9_input.txt");
-  std::vector<char> parsedInstructions = parseInstructions(instructions);
-  std::map<std::pair<int, int>, int> positionsVisitedByTail;
-  Knot head = Knot();
-  Knot tail = Knot();
-  positionsVisitedByTail.insert({tail.getXYPosition(), 1});
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0)
+    return false;
+  if (S_ISDIR(info.st_mode))
+  {
+    DIR * directory = opendir(path.c_str());
+    if (directory == nullptr)
+      return false;
+    for (struct dirent * entry = readdir(directory); entry != nullptr; entry = readdir(directory))
+    {
+      std::string file = path + "/" + entry->d_name;
+      if (entry->d_name[0] != '.' && stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+        files.push_back(file);
+    }
+    closedir(directory);
+    // readdir's order depends on the file system, so sort to keep the CSV stable
+    std::sort(files.begin(), files.end());
+  }
+  else
+  {
+    std::ifstream manifest(path);
+    if (!manifest.is_open())
+      return false;
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (!line.empty())
+        files.push_back(line);
+    }
+  }
+  return true;
+}
 
-  for (auto & dir : parsedInstructions)
+// Strictly read a motion file for a batch: every non-blank line must be a direction
+// (R, L, U or D), a space and a step count. Returns false with a description in error
+// if the file can't be opened or has any other line in it.
+bool readMotionFile(const std::string & filename, std::vector<Motion> & motions, std::string & error)
+{
+  std::ifstream file(filename);
+  if (!file.is_open())
   {
-    head.applyMovement(dir);
-    std::pair<int, int> relPosition = getRelativePosition(head, tail);
-    std::vector<char> tailMovementPattern = getTailMovementPattern(relPosition);
-    for (auto & c : tailMovementPattern)
+    error = "cannot open file";
+    return false;
+  }
+  std::string line;
+  for (size_t lineNumber = 1; std::getline(file, line); ++lineNumber)
+  {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty())
+      continue;
+    char * end = nullptr;
+    long steps = line.size() > 2 && line[1] == ' ' && isdigit((unsigned char)line[2]) ? std::strtol(line.c_str() + 2, &end, 10) : -1;
+    if (std::string("RLUD").find(line[0]) == std::string::npos || steps < 0 || steps > INT_MAX || *end != '\0')
     {
-      tail.applyMovement(c);
+      error = "line " + std::to_string(lineNumber) + " is not a motion";
+      return false;
     }
-    std::map<std::pair<int, int>, int>::iterator it = positionsVisitedByTail.find(tail.getXYPosition());
-    if (it == positionsVisitedByTail.end())
-      positionsVisitedByTail.insert({tail.getXYPosition(), 1});
+    motions.push_back(Motion(line[0], steps));
   }
-  std::cout << "PART 1" << std::endl;
-  std::cout << "After instructions, head's final x-position is " << head.getXPosition() << std::endl;
-  std::cout << "After instructions, head's final y-position is " << head.getYPosition() << std::endl;
-  std::cout << "After instructions, tail's final x-position is " << tail.getXPosition() << std::endl;
-  std::cout << "After instructions, tail's final y-position is " << tail.getYPosition() << std::endl;
-  std::cout << "The number of positions visited by the tail is " << positionsVisitedByTail.size() << std::endl << std::endl;;
+  return true;
+}
 
-  // Part 2
-  // It's useful to use the sample input for part 2 and compare it with the worked example
-  // instructions = readInstructions("./data/advent_of_code_day_9_part_2_sample_input.txt");
+// Answers for one motion file in a batch
+struct BatchResult
+{
+  BatchResult() : m_NumberOfMotions(0), m_NumberOfSteps(0), m_Part1(0), m_Part2(0) {};
+  // Empty unless the file couldn't be read, in which case there are no answers
+  std::string m_Error;
+  size_t m_NumberOfMotions;
+  size_t m_NumberOfSteps;
+  // Positions visited by the tail of a 2-knot rope
+  size_t m_Part1;
+  // Positions visited by the tail of a 10-knot rope
+  size_t m_Part2;
+};
+
+// A CSV field in double quotes, with any quotes inside doubled as RFC 4180 asks, so
+// commas and quotes in file names don't shift the columns
+std::string quoteCsvField(const std::string & field)
+{
+  std::string quoted = "\"";
+  for (char character : field)
+  {
+    if (character == '"')
+      quoted += '"';
+    quoted += character;
+  }
+  return quoted + "\"";
+}
 
-  // parsedInstructions = parseInstructions(instructions);
-  std::vector<Knot> rope(10);
-  positionsVisitedByTail.clear();
-  positionsVisitedByTail.insert({rope[9].getXYPosition(), 1});
-  for (auto  & dir : parsedInstructions)
+// Solve both parts for every motion file listed by input and write one CSV row per
+// file to csvFilename. Files are handed out to a fixed pool of worker threads, and each
+// worker reuses one simulator (and so its visited sets) for every file it takes.
+//
+// Files that can't be read or aren't motion files get an error in the CSV instead of
+// answers, and are reported on stderr. Returns false if that happened to any file, if
+// input can't be read, or if the CSV can't be written.
+bool runBatch(const std::string & input, const std::string & csvFilename, size_t numberOfThreads)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::string> files;
+  if (!listMotionFiles(input, files))
+  {
+    std::cerr << "Unable to read " << input << std::endl;
+    return false;
+  }
+  std::vector<BatchResult> results(files.size());
+  numberOfThreads = std::max<size_t>(1, std::min(numberOfThreads, files.size()));
+  std::atomic<size_t> nextFile(0);
+  std::vector<std::future<void> > workers;
+  for (size_t i = 0; i < numberOfThreads; ++i)
   {
-    // Apply the movement to the head
-    rope[0].applyMovement(dir);
+    workers.push_back(std::async(std::launch::async, [&]()
+                                 {
+                                   // Knot 1 is part 1's tail and knot 9 is part 2's
+                                   RopeSimulator rope(10, std::vector<size_t>{1, 9});
+                                   for (size_t file = nextFile++; file < files.size(); file = nextFile++)
+                                   {
+                                     BatchResult & result = results[file];
+                                     std::vector<Motion> motions;
+                                     if (!readMotionFile(files[file], motions, result.m_Error))
+                                       continue;
+                                     rope.reset();
+                                     rope.applyMotions(motions);
+                                     result.m_NumberOfMotions = motions.size();
+                                     for (auto & motion : motions)
+                                       result.m_NumberOfSteps += motion.m_Steps;
+                                     result.m_Part1 = rope.getNumberOfPositionsVisited(1);
+                                     result.m_Part2 = rope.getNumberOfPositionsVisited(9);
+                                   }
+                                 }));
+  }
+  for (size_t i = 0; i < workers.size(); ++i)
+    workers[i].get();
 
-    // Then for each subsequent knot, get the relative position to the previous knot
-    for (int i = 1; i < rope.size(); ++i)
+  std::ofstream csv(csvFilename);
+  if (!csv.is_open())
+  {
+    std::cerr << "Unable to write " << csvFilename << std::endl;
+    return false;
+  }
+  csv << "file,motions,steps,part_1,part_2,error" << std::endl;
+  size_t totalSteps = 0;
+  size_t numberOfFailures = 0;
+  for (size_t file = 0; file < files.size(); ++file)
+  {
+    const BatchResult & result = results[file];
+    if (!result.m_Error.empty())
     {
-      std::pair<int, int> relPosition = getRelativePosition(rope[i-1], rope[i]);
-      std::vector<char> nextKnotMovementPattern = getTailMovementPattern(relPosition);
-      for (auto & c : nextKnotMovementPattern)
-      {
-        rope[i].applyMovement(c);
-      }
-      std::map<std::pair<int, int>, int>::iterator it = positionsVisitedByTail.find(rope[9].getXYPosition());
-      if (it == positionsVisitedByTail.end())
-        positionsVisitedByTail.insert({rope[9].getXYPosition(), 1});
+      std::cerr << files[file] << ": " << result.m_Error << std::endl;
+      csv << quoteCsvField(files[file]) << ",,,,," << result.m_Error << std::endl;
+      ++numberOfFailures;
+      continue;
     }
+    csv << quoteCsvField(files[file]) << "," << result.m_NumberOfMotions << "," << result.m_NumberOfSteps << ","
+        << result.m_Part1 << "," << result.m_Part2 << "," << std::endl;
+    totalSteps += result.m_NumberOfSteps;
   }
+  csv.close();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Ran " << files.size() - numberOfFailures << " motion files (" << totalSteps << " steps) on " << numberOfThreads
+            << " thread(s) in " << seconds << " s: " << files.size() / seconds << " files/s, "
+            << totalSteps / seconds << " steps/s" << std::endl;
+  if (numberOfFailures > 0)
+    std::cerr << numberOfFailures << " of " << files.size() << " files failed" << std::endl;
+  return numberOfFailures == 0;
+}
+
+// Usage: advent_of_code_day_9 [--benchmark [number of steps]]
+//        advent_of_code_day_9 --batch <directory or manifest> <output csv> [number of threads]
+int main(int argc, char ** argv)
+{
+  if (argc > 1 && std::string(argv[1]) == "--benchmark")
+  {
+    runBenchmarks(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000000);
+    return 0;
+  }
+  if (argc > 3 && std::string(argv[1]) == "--batch")
+  {
+    size_t numberOfThreads = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : std::thread::hardware_concurrency();
+    return runBatch(argv[2], argv[3], numberOfThreads) ? 0 : 1;
+  }
+
+  std::vector<std::string> instructions = readInstructions("./data/advent_of_code_day_9_input.txt");
+  std::vector<Motion> parsedInstructions = parseInstructions(instructions);
+  // Part 1's two-knot rope is the first two knots of part 2's ten, so one simulation
+  // answers both
+  std::vector<size_t> everyKnot;
+  for (size_t knot = 0; knot < 10; ++knot)
+    everyKnot.push_back(knot);
+  RopeSimulator rope(10, everyKnot);
+  rope.applyMotions(parsedInstructions);
+  std::cout << "PART 1" << std::endl;
+  std::cout << "After instructions, head's final x-position is " << rope.getXPosition(0) << std::endl;
+  std::cout << "After instructions, head's final y-position is " << rope.getYPosition(0) << std::endl;
+  std::cout << "After instructions, tail's final x-position is " << rope.getXPosition(1) << std::endl;
+  std::cout << "After instructions, tail's final y-position is " << rope.getYPosition(1) << std::endl;
+  std::cout << "The number of positions visited by the tail is " << rope.getNumberOfPositionsVisited(1) << std::endl << std::endl;;
+
+  // Part 2
+  // It's useful to use the sample input for part 2 and compare it with the worked example
+  // instructions = readInstructions("./data/advent_of_code_day_9_part_2_sample_input.txt");
   std::cout << "PART 2" << std::endl;
-  std::cout << "After instructions, head's final x-position is " << rope[0].getXPosition() << std::endl;
-  std::cout << "After instructions, head's final y-position is " << rope[0].getYPosition() << std::endl;
-  std::cout << "After instructions, tail's final x-position is " << rope[9].getXPosition() << std::endl;
-  std::cout << "After instructions, tail's final y-position is " << rope[9].getYPosition() << std::endl;
-  std::cout << "The number of positions visited by the tail is " << positionsVisitedByTail.size() << std::endl;
+  std::cout << "After instructions, head's final x-position is " << rope.getXPosition(0) << std::endl;
+  std::cout << "After instructions, head's final y-position is " << rope.getYPosition(0) << std::endl;
+  std::cout << "After instructions, tail's final x-position is " << rope.getXPosition(9) << std::endl;
+  std::cout << "After instructions, tail's final y-position is " << rope.getYPosition(9) << std::endl;
+  std::cout << "The number of positions visited by the tail is " << rope.getNumberOfPositionsVisited(9) << std::endl;
+  std::cout << "Positions visited by each knot:";
+  for (size_t knot = 0; knot < rope.getNumberOfKnots(); ++knot)
+    std::cout << " " << rope.getNumberOfPositionsVisited(knot);
+  std::cout << std::endl;
   return 0;
 
 }
\ No newline at end of file